@@ -8,10 +8,13 @@
 #include "hardware/pio.h"
 #include "hardware/dma.h"
 #include "section.h"
+#include "busmon.h"
 
 #include "busmon.pio.h"
 
 static uint8_t __noinit(busmon_wr_value_table[0x100]) __attribute__ ((aligned (0x100)));
+static PIO busmon_wr_pio;
+static uint busmon_wr_sm;
 
 static void busmon_wr_init(PIO pio, uint sm, uint offset, uint pin, uint8_t *ram)
 {
@@ -38,10 +41,88 @@ static void busmon_wr_init(PIO pio, uint sm, uint offset, uint pin, uint8_t *ram
 #define BUSMON_CAP_BUFFER_SHIFT (6)
 #define BUSMON_CAP_BUFFER_COUNT (1 << BUSMON_CAP_BUFFER_SHIFT)
 static uint32_t __noinit(busmon_cap_buffer[BUSMON_CAP_BUFFER_COUNT]) __attribute__ ((aligned (sizeof(uint32_t) * BUSMON_CAP_BUFFER_COUNT)));
+static uint32_t *busmon_cap_buffer_ptr = busmon_cap_buffer;
 static uint32_t busmon_cap_buffer_count = BUSMON_CAP_BUFFER_COUNT;
 static int busmon_cap_dma_ch = 0;
 static volatile uint32_t *busmon_cap_buffer_wp_ptr = NULL;
-static uint32_t busmon_cap_buffer_rp = 0;
+static uint32_t busmon_cap_buffer_rp = 0;       // sequence number of the next entry to pop
+// the restart channel reads the buffer address from this ring, its read address counts laps
+#define BUSMON_CAP_LAP_SHIFT (6)
+#define BUSMON_CAP_LAP_COUNT (1 << BUSMON_CAP_LAP_SHIFT)
+static uint32_t __noinit(busmon_cap_lap_table[BUSMON_CAP_LAP_COUNT]) __attribute__ ((aligned (sizeof(uint32_t) * BUSMON_CAP_LAP_COUNT)));
+static volatile uint32_t *busmon_cap_lap_ptr = NULL;
+static volatile uint32_t busmon_cap_lap = 0;    // laps, low bits follow the DMA
+static PIO busmon_cap_pio;
+static uint busmon_cap_sm;
+static busmon_cap_stat_t busmon_cap_stat;
+static bool busmon_cap_ts = false;
+static uint32_t busmon_cap_filter_bits = 0;     // address bits compared in PIO (0: no filter)
+static uint32_t busmon_cap_filter_block = 0;    // fed to busmon_cap_filt by DMA
+static uint32_t busmon_cap_filter_feed_count = 0x10000;
+static uint32_t busmon_cap_record_words = 1;    // 2: bus condition + timestamp
+
+static void busmon_cap_ts_init(PIO pio, uint sm, uint offset, uint pin)
+{
+    pio_sm_set_consecutive_pindirs(pio, sm, pin, busmon_cap_ts_bit_width, false);
+    pio_sm_config c = busmon_cap_ts_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, pin);
+    sm_config_set_in_shift(&c, true, false, 32);
+    sm_config_set_out_shift(&c, true, false, 32);
+    sm_config_set_clkdiv_int_frac(&c, 1, 0);
+    pio_sm_init(pio, sm, offset + busmon_cap_ts_offset_entry_point, &c);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+static void busmon_cap_filt_init(PIO pio, uint sm, uint offset, uint pin)
+{
+    const uint32_t bits = busmon_cap_filter_bits;
+    pio->instr_mem[offset + busmon_cap_filt_offset_patch_shift] =
+        (bits < busmon_cap_filt_addr_bus_width) ? pio_encode_out(pio_null, busmon_cap_filt_addr_bus_width - bits) : pio_encode_nop();
+    pio->instr_mem[offset + busmon_cap_filt_offset_patch_bits] = pio_encode_out(pio_y, bits);
+
+    pio_sm_set_consecutive_pindirs(pio, sm, pin, busmon_cap_filt_bit_width, false);
+    pio_sm_config c = busmon_cap_filt_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, pin);
+    sm_config_set_in_shift(&c, true, false, 32);
+    sm_config_set_out_shift(&c, true, false, 32);
+    sm_config_set_clkdiv_int_frac(&c, 1, 0);
+    pio_sm_init(pio, sm, offset + busmon_cap_filt_offset_entry_point, &c);
+
+    // keep the TX FIFO filled with the address block
+    dma_channel_config cc;
+    int dma_feed = dma_claim_unused_channel(true);
+    int dma_feed_trig = dma_claim_unused_channel(true);
+
+    cc = dma_channel_get_default_config(dma_feed_trig);
+    channel_config_set_transfer_data_size(&cc, DMA_SIZE_32);
+    channel_config_set_read_increment(&cc, false);
+    channel_config_set_write_increment(&cc, false);
+    dma_channel_configure(
+        dma_feed_trig,
+        &cc,
+        &dma_hw->ch[dma_feed].al1_transfer_count_trig,
+        &busmon_cap_filter_feed_count,
+        1,
+        false
+    );
+
+    cc = dma_channel_get_default_config(dma_feed);
+    channel_config_set_transfer_data_size(&cc, DMA_SIZE_32);
+    channel_config_set_read_increment(&cc, false);
+    channel_config_set_write_increment(&cc, false);
+    channel_config_set_dreq(&cc, pio_get_dreq(pio, sm, true));
+    channel_config_set_chain_to(&cc, dma_feed_trig);
+    dma_channel_configure(
+        dma_feed,
+        &cc,
+        &pio->txf[sm],
+        &busmon_cap_filter_block,
+        busmon_cap_filter_feed_count,
+        true
+    );
+
+    pio_sm_set_enabled(pio, sm, true);
+}
 
 static void busmon_cap_init(PIO pio, uint sm, uint offset, uint pin)
 {
@@ -55,14 +136,57 @@ static void busmon_cap_init(PIO pio, uint sm, uint offset, uint pin)
 }
 
 
-void busmon_init(PIO pio, uint pin, uint8_t *ram)
+static void busmon_wp_init(PIO pio, uint sm, uint offset, uint pin, uint32_t wp_start, uint32_t wp_size)
 {
-    dma_channel_config c;
+    // write protected block: aligned power of two (wp_size == 0: none)
+    uint32_t block_bits = 0;
+    uint32_t block = ~0u;
+    if (wp_size != 0)
+    {
+        block_bits = busmon_wp_addr_bus_width - __builtin_ctz(wp_size);
+        block = wp_start >> (busmon_wp_addr_bus_width - block_bits);
+    }
+    pio->instr_mem[offset + busmon_wp_offset_patch_shift] =
+        (block_bits < busmon_wp_addr_bus_width) ? pio_encode_out(pio_null, busmon_wp_addr_bus_width - block_bits) : pio_encode_nop();
+    pio->instr_mem[offset + busmon_wp_offset_patch_bits] =
+        (block_bits > 0) ? pio_encode_out(pio_x, block_bits) : pio_encode_mov(pio_x, pio_null);
 
-    // Capture write data
-    uint offset_busmon_wr = pio_add_program(pio, &busmon_wr_program);
-    uint sm_busmon_wr = pio_claim_unused_sm(pio, true);
-    busmon_wr_init(pio, sm_busmon_wr, offset_busmon_wr, pin, ram);
+    pio_sm_set_consecutive_pindirs(pio, sm, pin, busmon_wr_bit_width, false);
+    pio_sm_config c = busmon_wp_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, pin);
+    sm_config_set_in_shift(&c, true, false, 32);
+    sm_config_set_out_shift(&c, true, false, 32);
+    sm_config_set_clkdiv_int_frac(&c, 1, 0);
+    pio_sm_init(pio, sm, offset + busmon_wp_offset_entry_point, &c);
+    pio_sm_set_enabled(pio, sm, true);
+
+    pio_sm_put_blocking(pio, sm, block);
+}
+
+static void busmon_sram_init(PIO pio, uint sm, uint offset, uint8_t *image)
+{
+    for (int32_t i = 0; i < 0x100; i++)
+    {
+        busmon_wr_value_table[i] = (uint8_t)i;
+    }
+
+    pio_sm_config c = busmon_sram_program_get_default_config(offset);
+    sm_config_set_in_shift(&c, true, false, 32);
+    sm_config_set_out_shift(&c, true, false, 32);
+    sm_config_set_clkdiv_int_frac(&c, 1, 0);
+    pio_sm_init(pio, sm, offset + busmon_sram_offset_entry_point, &c);
+    pio_sm_set_enabled(pio, sm, true);
+
+    uint32_t imageaddr_top = (uint32_t)image >> busmon_sram_addr_bus_width;
+    pio_sm_put_blocking(pio, sm, imageaddr_top);
+    uint32_t valaddr_top = (uint32_t)busmon_wr_value_table >> busmon_sram_data_bus_width;
+    pio_sm_put_blocking(pio, sm, valaddr_top);
+}
+
+// write the bytes described by the address pairs from the sm (value address, destination address)
+static void busmon_wr_dma_init(PIO pio, uint sm_busmon_wr)
+{
+    dma_channel_config c;
 
     int dma_wr_addr = dma_claim_unused_channel(true);
     int dma_wr_data = dma_claim_unused_channel(true);
@@ -97,24 +221,58 @@ void busmon_init(PIO pio, uint pin, uint8_t *ram)
     );
 
     dma_channel_start(dma_wr_addr);
+}
+
+// busmon_cap_ts uses a jump table at offset 0: add it before other programs
+static uint busmon_cap_add_program(PIO pio)
+{
+    if (busmon_cap_ts)
+    {
+        return pio_add_program(pio, &busmon_cap_ts_program);
+    }
+    if (busmon_cap_filter_bits != 0)
+    {
+        return pio_add_program(pio, &busmon_cap_filt_program);
+    }
+    return pio_add_program(pio, &busmon_cap_program);
+}
+
+static void busmon_cap_setup(PIO pio, uint pin, uint offset_busmon_cap)
+{
+    dma_channel_config c;
 
-    // Capture data access
-    uint offset_busmon_cap = pio_add_program(pio, &busmon_cap_program);
     uint sm_busmon_cap = pio_claim_unused_sm(pio, true);
-    busmon_cap_init(pio, sm_busmon_cap, offset_busmon_cap, pin);
+    if (busmon_cap_ts)
+    {
+        busmon_cap_ts_init(pio, sm_busmon_cap, offset_busmon_cap, pin);
+    }
+    else if (busmon_cap_filter_bits != 0)
+    {
+        busmon_cap_filt_init(pio, sm_busmon_cap, offset_busmon_cap, pin);
+    }
+    else
+    {
+        busmon_cap_init(pio, sm_busmon_cap, offset_busmon_cap, pin);
+    }
 
     int dma_cap_trig = dma_claim_unused_channel(true);
     int dma_cap_buff = dma_claim_unused_channel(true);
 
+    // restart from the top of the buffer (transfer count is reloaded by the trigger)
+    for (int32_t i = 0; i < BUSMON_CAP_LAP_COUNT; i++)
+    {
+        busmon_cap_lap_table[i] = (uint32_t)busmon_cap_buffer_ptr;
+    }
     c = dma_channel_get_default_config(dma_cap_trig);
     channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
-    channel_config_set_read_increment(&c, false);
+    channel_config_set_read_increment(&c, true);
     channel_config_set_write_increment(&c, false);
+    channel_config_set_ring(&c, false, BUSMON_CAP_LAP_SHIFT + 2);
     dma_channel_configure(
         dma_cap_trig,
         &c,
-        &dma_hw->ch[dma_cap_buff].al1_transfer_count_trig,
-        &busmon_cap_buffer_count,
+        &dma_hw->ch[dma_cap_buff].al2_write_addr_trig,
+        busmon_cap_lap_table,
         1,
         false
     );
@@ -123,41 +281,214 @@ void busmon_init(PIO pio, uint pin, uint8_t *ram)
     channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
     channel_config_set_read_increment(&c, false);
     channel_config_set_write_increment(&c, true);
-    channel_config_set_ring(&c, true, BUSMON_CAP_BUFFER_SHIFT + 2);
     channel_config_set_dreq(&c, pio_get_dreq(pio, sm_busmon_cap, false));
     channel_config_set_chain_to(&c, dma_cap_trig);
     dma_channel_configure(
         dma_cap_buff,
         &c,
-        busmon_cap_buffer,
+        busmon_cap_buffer_ptr,
         &pio->rxf[sm_busmon_cap],
-        BUSMON_CAP_BUFFER_COUNT,
+        busmon_cap_buffer_count,
         false
     );
 
+    busmon_cap_pio = pio;
+    busmon_cap_sm = sm_busmon_cap;
     busmon_cap_dma_ch = dma_cap_buff;
     busmon_cap_buffer_wp_ptr = &dma_hw->ch[busmon_cap_dma_ch].write_addr;
+    busmon_cap_lap_ptr = &dma_hw->ch[dma_cap_trig].read_addr;
+    busmon_cap_lap = 0;                         // the first restart reads entry 0
+
     dma_channel_start(dma_cap_trig);
 }
 
-static inline uint32_t busmon_cap_buffer_wp(void)
+void busmon_init(PIO pio, uint pin, uint8_t *ram)
 {
-    return (*busmon_cap_buffer_wp_ptr / 4) % BUSMON_CAP_BUFFER_COUNT;
+    uint offset_busmon_cap = busmon_cap_add_program(pio);
+
+    // Capture write data
+    uint offset_busmon_wr = pio_add_program(pio, &busmon_wr_program);
+    uint sm_busmon_wr = pio_claim_unused_sm(pio, true);
+    busmon_wr_init(pio, sm_busmon_wr, offset_busmon_wr, pin, ram);
+    busmon_wr_pio = pio;
+    busmon_wr_sm = sm_busmon_wr;
+    busmon_wr_dma_init(pio, sm_busmon_wr);
+
+    // Capture data access
+    busmon_cap_setup(pio, pin, offset_busmon_cap);
 }
 
+// write data into the emulated image except for the write protected block
+// busmon_sram and busmon_wp fill most of pio, the capture goes to cap_pio
+// (romemu_io + romemu_oe use 14 of 32: busmon_cap_ts fits, busmon_cap_filt does not)
+void busmon_init_sram(PIO pio, PIO cap_pio, uint pin, uint8_t *image, uint32_t wp_start, uint32_t wp_size)
+{
+    dma_channel_config c;
+
+    uint offset_busmon_sram = pio_add_program(pio, &busmon_sram_program);
+    uint sm_busmon_sram = pio_claim_unused_sm(pio, true);
+    busmon_sram_init(pio, sm_busmon_sram, offset_busmon_sram, image);
+    busmon_wr_pio = pio;
+    busmon_wr_sm = sm_busmon_sram;
+    busmon_wr_dma_init(pio, sm_busmon_sram);
+
+    uint offset_busmon_wp = pio_add_program(pio, &busmon_wp_program);
+    uint sm_busmon_wp = pio_claim_unused_sm(pio, true);
+    busmon_wp_init(pio, sm_busmon_wp, offset_busmon_wp, pin, wp_start, wp_size);
+
+    int dma_wp = dma_claim_unused_channel(true);
+    c = dma_channel_get_default_config(dma_wp);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm_busmon_wp, false));
+    dma_channel_configure(
+        dma_wp,
+        &c,
+        &pio->txf[sm_busmon_sram],
+        &pio->rxf[sm_busmon_wp],
+        0xffffffff,
+        true
+    );
+
+    // Capture data access (no room for busmon_cap_filt)
+    busmon_cap_filter_bits = 0;
+    busmon_cap_setup(cap_pio, pin, busmon_cap_add_program(cap_pio));
+}
+
+void busmon_wr_stop(void)
+{
+    pio_sm_set_enabled(busmon_wr_pio, busmon_wr_sm, false);
+}
+
+// sequence number of the next entry written by DMA
+// the lap comes from the DMA (modulo BUSMON_CAP_LAP_COUNT), so this must be called
+// at least once per BUSMON_CAP_LAP_COUNT laps: core1 polls it all the time
+static uint32_t busmon_cap_buffer_wp(void)
+{
+    uint32_t lap_addr;
+    uint32_t offset;
+
+    // restart at the end of the buffer: the buffer channel completes with its
+    // write address at the end, chains to the trig channel, whose READ_ADDR
+    // steps to the next lap entry when it has read the table and before it
+    // writes the buffer channel's write address. Inside this window the lap is
+    // either side of the restart, so wait for the write address to return into
+    // the buffer (unpaced DMA: a few cycles)
+    do
+    {
+        lap_addr = *busmon_cap_lap_ptr;
+        offset = (*busmon_cap_buffer_wp_ptr - (uint32_t)busmon_cap_buffer_ptr) / 4;
+    } while ((offset >= busmon_cap_buffer_count) || (lap_addr != *busmon_cap_lap_ptr));
+
+    // entry read by the last restart
+    const uint32_t dma_lap = (lap_addr - (uint32_t)busmon_cap_lap_table) / 4 - 1;
+
+    // both cores may extend it: a stale store is corrected by the next call
+    const uint32_t last = busmon_cap_lap;
+    const uint32_t lap = last + ((dma_lap - last) & (BUSMON_CAP_LAP_COUNT - 1));
+    busmon_cap_lap = lap;
+
+    return lap * busmon_cap_buffer_count + offset;
+}
+
+// use a large buffer for the capture (call before busmon_init)
+void busmon_cap_set_buffer(uint32_t *buffer, uint32_t count)
+{
+    busmon_cap_buffer_ptr = buffer;
+    busmon_cap_buffer_count = count;
+}
+
+// record a timestamp after each bus condition (call before busmon_init)
+void busmon_cap_set_timestamp(bool enable)
+{
+    busmon_cap_ts = enable;
+    busmon_cap_record_words = enable ? 2 : 1;
+}
+
+// capture only the aligned power of two address block (call before busmon_init)
+void busmon_cap_set_filter(uint32_t start, uint32_t size)
+{
+    if ((size == 0) || (size > 0x8000))
+    {
+        busmon_cap_filter_bits = 0;
+        return;
+    }
+    busmon_cap_filter_bits = busmon_cap_filt_addr_bus_width - __builtin_ctz(size);
+    busmon_cap_filter_block = start >> (busmon_cap_filt_addr_bus_width - busmon_cap_filter_bits);
+}
+
+bool busmon_cap_has_timestamp(void)
+{
+    return busmon_cap_ts;
+}
+
+// system clock cycles per timestamp count
+uint32_t busmon_cap_timestamp_cycles(void)
+{
+    return busmon_cap_ts_loop_cycles;
+}
+
+uint32_t busmon_cap_write_pos(void)
+{
+    return busmon_cap_buffer_wp();
+}
+
+// the PIO could not push (FIFO full): events were lost before DMA (core1 only)
+static void busmon_cap_check_stall(void)
+{
+    const uint32_t mask = 1u << (PIO_FDEBUG_RXSTALL_LSB + busmon_cap_sm);
+    if (busmon_cap_pio->fdebug & mask)
+    {
+        busmon_cap_pio->fdebug = mask;
+        busmon_cap_stat.stall++;
+    }
+}
+
+// core1: follow the DMA without reading (the buffer is read elsewhere)
 void busmon_cap_start(void)
 {
-    busmon_cap_buffer_rp = busmon_cap_buffer_wp();
+    busmon_cap_buffer_rp = busmon_cap_buffer_wp() & ~(busmon_cap_record_words - 1);
+    busmon_cap_check_stall();
 }
 
+// core1 only: the reader state and the loss counters are not shared
 bool busmon_cap_is_empty(void)
 {
-    return (busmon_cap_buffer_rp == busmon_cap_buffer_wp());
+    const uint32_t wp = busmon_cap_buffer_wp();
+    const uint32_t lag = wp - busmon_cap_buffer_rp;
+
+    // lapped by DMA: skip to the oldest entry still in the buffer
+    if (lag > busmon_cap_buffer_count)
+    {
+        const uint32_t rp = (wp - busmon_cap_buffer_count + busmon_cap_record_words - 1) & ~(busmon_cap_record_words - 1);
+        busmon_cap_stat.overflow++;
+        busmon_cap_stat.dropped += (rp - busmon_cap_buffer_rp) / busmon_cap_record_words;
+        busmon_cap_buffer_rp = rp;
+    }
+    busmon_cap_check_stall();
+
+    return (wp - busmon_cap_buffer_rp < busmon_cap_record_words);
 }
 
 uint32_t busmon_cap_pop(void)
 {
-    const uint32_t ret = busmon_cap_buffer[busmon_cap_buffer_rp];
-    busmon_cap_buffer_rp = (busmon_cap_buffer_rp + 1) % BUSMON_CAP_BUFFER_COUNT;
+    const uint32_t ret = busmon_cap_buffer_ptr[busmon_cap_buffer_rp % busmon_cap_buffer_count];
+    busmon_cap_buffer_rp++;
     return ret;
+}
+
+// records dropped and stalls so far (cheap, for core1 loop)
+void busmon_cap_get_lost(uint32_t *dropped, uint32_t *stall)
+{
+    *dropped = busmon_cap_stat.dropped;
+    *stall = busmon_cap_stat.stall;
+}
+
+// any core: a snapshot of the counters updated by core1
+void busmon_cap_get_stat(busmon_cap_stat_t *stat)
+{
+    *stat = busmon_cap_stat;
+    stat->count = busmon_cap_buffer_count;
+    stat->written = busmon_cap_buffer_wp();
 }
\ No newline at end of file
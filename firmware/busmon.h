@@ -10,9 +10,28 @@
 #include <stdint.h>
 #include "hardware/pio.h"
 
+typedef struct
+{
+    uint32_t count;     // buffer entries
+    uint32_t written;   // entries written by DMA (sequence number)
+    uint32_t overflow;  // times the reader was lapped
+    uint32_t dropped;   // records overwritten before being read
+    uint32_t stall;     // times the PIO RX FIFO was full (records lost, count unknown)
+} busmon_cap_stat_t;
+
 void busmon_init(PIO pio, uint pin, uint8_t *ram);
+void busmon_init_sram(PIO pio, PIO cap_pio, uint pin, uint8_t *image, uint32_t wp_start, uint32_t wp_size);
+void busmon_wr_stop(void);
+void busmon_cap_set_buffer(uint32_t *buffer, uint32_t count);
+uint32_t busmon_cap_write_pos(void);
+void busmon_cap_set_timestamp(bool enable);
+void busmon_cap_set_filter(uint32_t start, uint32_t size);
+bool busmon_cap_has_timestamp(void);
+uint32_t busmon_cap_timestamp_cycles(void);
 void busmon_cap_start(void);
 bool busmon_cap_is_empty(void);
 uint32_t busmon_cap_pop(void);
+void busmon_cap_get_lost(uint32_t *dropped, uint32_t *stall);
+void busmon_cap_get_stat(busmon_cap_stat_t *stat);
 
 #endif
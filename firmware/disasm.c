@@ -0,0 +1,819 @@
+/*
+ * Copyright (c) 2024 Hirokuni Yano
+ *
+ * Released under the MIT license.
+ * see https://opensource.org/licenses/MIT
+ */
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "disasm.h"
+
+// all tables live in RAM with the rest of the image: the flash is not
+// safely readable at the overclocked speed
+
+static const char *disasm_cpu_names[DISASM_CPU_NUM] = {"6502", "z80", "6809"};
+
+//
+// 6502 (NMOS, documented opcodes)
+//
+typedef enum mode_6502
+{
+    M6502_IMP, M6502_ACC, M6502_IMM, M6502_ZP, M6502_ZPX, M6502_ZPY, M6502_ABS,
+    M6502_ABX, M6502_ABY, M6502_IND, M6502_IZX, M6502_IZY, M6502_REL,
+} mode_6502_e;
+
+static const uint8_t len_6502[] = {1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 2, 2, 2};
+
+// mnemonic | mode << 6 | data reads << 10
+static const uint16_t op_6502[256] =
+{
+    0x080b, 0x0ea3, 0x0000, 0x0000, 0x0000, 0x04e3, 0x04c3, 0x0000,
+    0x0025, 0x00a3, 0x0043, 0x0000, 0x0000, 0x05a3, 0x0583, 0x0000,
+    0x030a, 0x0ee3, 0x0000, 0x0000, 0x0000, 0x0923, 0x0903, 0x0000,
+    0x000e, 0x0a23, 0x0000, 0x0000, 0x0000, 0x09e3, 0x09c3, 0x0000,
+    0x019d, 0x0e82, 0x0000, 0x0000, 0x04c7, 0x04c2, 0x04e8, 0x0000,
+    0x0427, 0x0082, 0x0068, 0x0000, 0x0587, 0x0582, 0x05a8, 0x0000,
+    0x0308, 0x0ec2, 0x0000, 0x0000, 0x0000, 0x0902, 0x0928, 0x0000,
+    0x002d, 0x0a02, 0x0000, 0x0000, 0x0000, 0x09c2, 0x09e8, 0x0000,
+    0x0c2a, 0x0e98, 0x0000, 0x0000, 0x0000, 0x04d8, 0x04e1, 0x0000,
+    0x0024, 0x0098, 0x0061, 0x0000, 0x019c, 0x0598, 0x05a1, 0x0000,
+    0x030c, 0x0ed8, 0x0000, 0x0000, 0x0000, 0x0918, 0x0921, 0x0000,
+    0x0010, 0x0a18, 0x0000, 0x0000, 0x0000, 0x09d8, 0x09e1, 0x0000,
+    0x082b, 0x0e81, 0x0000, 0x0000, 0x0000, 0x04c1, 0x04e9, 0x0000,
+    0x0426, 0x0081, 0x0069, 0x0000, 0x0a5c, 0x0581, 0x05a9, 0x0000,
+    0x030d, 0x0ec1, 0x0000, 0x0000, 0x0000, 0x0901, 0x0929, 0x0000,
+    0x002f, 0x0a01, 0x0000, 0x0000, 0x0000, 0x09c1, 0x09e9, 0x0000,
+    0x0000, 0x0ab0, 0x0000, 0x0000, 0x00f2, 0x00f0, 0x00f1, 0x0000,
+    0x0017, 0x0000, 0x0036, 0x0000, 0x01b2, 0x01b0, 0x01b1, 0x0000,
+    0x0304, 0x0ef0, 0x0000, 0x0000, 0x0532, 0x0530, 0x0571, 0x0000,
+    0x0038, 0x0630, 0x0037, 0x0000, 0x0000, 0x05f0, 0x0000, 0x0000,
+    0x00a0, 0x0e9e, 0x009f, 0x0000, 0x04e0, 0x04de, 0x04df, 0x0000,
+    0x0034, 0x009e, 0x0033, 0x0000, 0x05a0, 0x059e, 0x059f, 0x0000,
+    0x0305, 0x0ede, 0x0000, 0x0000, 0x0920, 0x091e, 0x095f, 0x0000,
+    0x0011, 0x0a1e, 0x0035, 0x0000, 0x09e0, 0x09de, 0x0a1f, 0x0000,
+    0x0094, 0x0e92, 0x0000, 0x0000, 0x04d4, 0x04d2, 0x04d5, 0x0000,
+    0x001b, 0x0092, 0x0016, 0x0000, 0x0594, 0x0592, 0x0595, 0x0000,
+    0x0309, 0x0ed2, 0x0000, 0x0000, 0x0000, 0x0912, 0x0915, 0x0000,
+    0x000f, 0x0a12, 0x0000, 0x0000, 0x0000, 0x09d2, 0x09d5, 0x0000,
+    0x0093, 0x0eac, 0x0000, 0x0000, 0x04d3, 0x04ec, 0x04d9, 0x0000,
+    0x001a, 0x00ac, 0x0022, 0x0000, 0x0593, 0x05ac, 0x0599, 0x0000,
+    0x0306, 0x0eec, 0x0000, 0x0000, 0x0000, 0x092c, 0x0919, 0x0000,
+    0x002e, 0x0a2c, 0x0000, 0x0000, 0x0000, 0x09ec, 0x09d9, 0x0000,
+};
+
+static const char mn_6502[][4] =
+{
+    "???", "ADC", "AND", "ASL", "BCC", "BCS", "BEQ", "BIT",
+    "BMI", "BNE", "BPL", "BRK", "BVC", "BVS", "CLC", "CLD",
+    "CLI", "CLV", "CMP", "CPX", "CPY", "DEC", "DEX", "DEY",
+    "EOR", "INC", "INX", "INY", "JMP", "JSR", "LDA", "LDX",
+    "LDY", "LSR", "NOP", "ORA", "PHA", "PHP", "PLA", "PLP",
+    "ROL", "ROR", "RTI", "RTS", "SBC", "SEC", "SED", "SEI",
+    "STA", "STX", "STY", "TAX", "TAY", "TSX", "TXA", "TXS",
+    "TYA",
+};
+
+static uint32_t length_6502(const uint8_t *code)
+{
+    return len_6502[(op_6502[code[0]] >> 6) & 0xf];
+}
+
+static void format_6502(const uint8_t *code, uint32_t pc, char *buf, size_t size)
+{
+    static const char *fmt[] =
+    {
+        "%s", "%s A", "%s #$%02X", "%s $%02X", "%s $%02X,X", "%s $%02X,Y", "%s $%04X",
+        "%s $%04X,X", "%s $%04X,Y", "%s ($%04X)", "%s ($%02X,X)", "%s ($%02X),Y", "%s $%04X",
+    };
+    const uint32_t op = op_6502[code[0]];
+    const uint32_t mode = (op >> 6) & 0xf;
+    uint32_t value = code[1];
+
+    if (len_6502[mode] == 3)
+    {
+        value = code[1] | (code[2] << 8);
+    }
+    else if (mode == M6502_REL)
+    {
+        value = (pc + 2 + (int8_t)code[1]) & 0xffff;
+    }
+    snprintf(buf, size, fmt[mode], mn_6502[op & 0x3f], value);
+}
+
+//
+// Z80
+//
+// length (0: prefix) | (HL) operand << 2 | data reads << 3
+static const uint8_t op_z80[256] =
+{
+    0x01, 0x03, 0x01, 0x01, 0x01, 0x01, 0x02, 0x01, 0x01, 0x01, 0x09, 0x01, 0x01, 0x01, 0x02, 0x01,
+    0x02, 0x03, 0x01, 0x01, 0x01, 0x01, 0x02, 0x01, 0x02, 0x01, 0x09, 0x01, 0x01, 0x01, 0x02, 0x01,
+    0x02, 0x03, 0x03, 0x01, 0x01, 0x01, 0x02, 0x01, 0x02, 0x01, 0x13, 0x01, 0x01, 0x01, 0x02, 0x01,
+    0x02, 0x03, 0x03, 0x01, 0x0d, 0x0d, 0x06, 0x01, 0x02, 0x01, 0x0b, 0x01, 0x01, 0x01, 0x02, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01,
+    0x05, 0x05, 0x05, 0x05, 0x05, 0x05, 0x01, 0x05, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01,
+    0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0d, 0x01,
+    0x11, 0x11, 0x03, 0x03, 0x03, 0x01, 0x02, 0x01, 0x11, 0x11, 0x03, 0x00, 0x03, 0x03, 0x02, 0x01,
+    0x11, 0x11, 0x03, 0x02, 0x03, 0x01, 0x02, 0x01, 0x11, 0x01, 0x03, 0x02, 0x03, 0x00, 0x02, 0x01,
+    0x11, 0x11, 0x03, 0x11, 0x03, 0x01, 0x02, 0x01, 0x11, 0x01, 0x03, 0x01, 0x03, 0x00, 0x02, 0x01,
+    0x11, 0x11, 0x03, 0x01, 0x03, 0x01, 0x02, 0x01, 0x11, 0x01, 0x03, 0x01, 0x03, 0x00, 0x02, 0x01,
+};
+
+static const char *r_z80[] = {"B", "C", "D", "E", "H", "L", "(HL)", "A"};
+static const char *rp_z80[] = {"BC", "DE", "HL", "SP"};
+static const char *rp2_z80[] = {"BC", "DE", "HL", "AF"};
+static const char *cc_z80[] = {"NZ", "Z", "NC", "C", "PO", "PE", "P", "M"};
+static const char *alu_z80[] = {"ADD A,", "ADC A,", "SUB ", "SBC A,", "AND ", "XOR ", "OR ", "CP "};
+static const char *rot_z80[] = {"RLC", "RRC", "RL", "RR", "SLA", "SRA", "SLL", "SRL"};
+static const char *x0z7_z80[] = {"RLCA", "RRCA", "RLA", "RRA", "DAA", "CPL", "SCF", "CCF"};
+static const char *x3z3_z80[] = {"", "", "OUT (%02XH),A", "IN A,(%02XH)", "EX (SP),HL", "EX DE,HL", "DI", "EI"};
+static const char *block_z80[] = {"LDI", "CPI", "INI", "OUTI", "LDD", "CPD", "IND", "OUTD",
+                                  "LDIR", "CPIR", "INIR", "OTIR", "LDDR", "CPDR", "INDR", "OTDR"};
+static const char *x1z7_z80[] = {"LD I,A", "LD R,A", "LD A,I", "LD A,R", "RRD", "RLD", "NOP", "NOP"};
+
+static uint32_t length_z80(const uint8_t *code, uint32_t count)
+{
+    const uint32_t op = code[0];
+
+    if ((op == 0xcb) || (op == 0xed) || (op == 0xdd) || (op == 0xfd))
+    {
+        if (count < 2)
+        {
+            return 0;
+        }
+    }
+    if (op == 0xcb)
+    {
+        return 2;
+    }
+    if (op == 0xed)
+    {
+        // LD (nn),rp / LD rp,(nn)
+        return ((code[1] & 0xc7) == 0x43) ? 4 : 2;
+    }
+    if ((op == 0xdd) || (op == 0xfd))
+    {
+        const uint32_t info = op_z80[code[1]];
+        if (code[1] == 0xcb)
+        {
+            return 4;
+        }
+        if ((info & 3) == 0)
+        {
+            // another prefix: this one acts as a NOP
+            return 1;
+        }
+        // (HL) becomes (IX+d)
+        return 1 + (info & 3) + ((info >> 2) & 1);
+    }
+    return op_z80[op] & 3;
+}
+
+static uint32_t data_reads_z80(const uint8_t *code)
+{
+    uint32_t op = code[0];
+
+    if ((op == 0xdd) || (op == 0xfd))
+    {
+        op = code[1];
+        if (op == 0xcb)
+        {
+            return 1;
+        }
+    }
+    if (op == 0xcb)
+    {
+        return ((code[1] & 7) == 6) ? 1 : 0;
+    }
+    if (op == 0xed)
+    {
+        const uint32_t ed = code[1];
+        if ((ed & 0xcf) == 0x4b)
+        {
+            return 2;   // LD rp,(nn)
+        }
+        if (((ed & 0xc7) == 0x45) || ((ed & 0xf7) == 0x67))
+        {
+            return ((ed & 0xc7) == 0x45) ? 2 : 1;   // RETN/RETI, RRD/RLD
+        }
+        return (((ed & 0xe4) == 0xa0) && ((ed & 3) != 2)) ? 1 : 0;   // block LD, CP, OUT
+    }
+    return (op_z80[op] >> 3) & 3;
+}
+
+static void format_z80(const uint8_t *code, uint32_t pc, char *buf, size_t size)
+{
+    const char *ix = NULL;
+    char mem[12];
+    uint32_t i = 0;
+    uint32_t op = code[0];
+
+    if ((op == 0xdd) || (op == 0xfd))
+    {
+        ix = (op == 0xdd) ? "IX" : "IY";
+        if ((op_z80[code[1]] & 3) == 0 && (code[1] != 0xcb))
+        {
+            snprintf(buf, size, "NOP*");
+            return;
+        }
+        i = 1;
+        op = code[1];
+    }
+    if (op == 0xcb)
+    {
+        // DD CB d op: displacement comes before the opcode
+        const uint32_t cb = ix ? code[3] : code[1];
+        const uint32_t y = (cb >> 3) & 7;
+        const uint32_t z = cb & 7;
+        const char *reg = r_z80[z];
+        if (ix)
+        {
+            snprintf(mem, sizeof(mem), "(%s%+d)", ix, (int8_t)code[2]);
+            reg = mem;
+        }
+        switch (cb >> 6)
+        {
+        case 0:
+            snprintf(buf, size, "%s %s", rot_z80[y], reg);
+            break;
+        case 1:
+            snprintf(buf, size, "BIT %d,%s", y, reg);
+            break;
+        case 2:
+            snprintf(buf, size, "RES %d,%s", y, reg);
+            break;
+        default:
+            snprintf(buf, size, "SET %d,%s", y, reg);
+            break;
+        }
+        return;
+    }
+    if (op == 0xed)
+    {
+        const uint32_t ed = code[1];
+        const uint32_t x = ed >> 6;
+        const uint32_t y = (ed >> 3) & 7;
+        const uint32_t z = ed & 7;
+        const uint32_t nn = code[2] | (code[3] << 8);
+        if ((x == 2) && (y >= 4) && (z <= 3))
+        {
+            snprintf(buf, size, "%s", block_z80[(y - 4) * 4 + z]);
+        }
+        else if (x != 1)
+        {
+            snprintf(buf, size, "NOP*");
+        }
+        else if (z == 0)
+        {
+            if (y == 6)
+            {
+                snprintf(buf, size, "IN (C)");
+            }
+            else
+            {
+                snprintf(buf, size, "IN %s,(C)", r_z80[y]);
+            }
+        }
+        else if (z == 1)
+        {
+            snprintf(buf, size, "OUT (C),%s", (y == 6) ? "0" : r_z80[y]);
+        }
+        else if (z == 2)
+        {
+            snprintf(buf, size, "%s HL,%s", (y & 1) ? "ADC" : "SBC", rp_z80[y >> 1]);
+        }
+        else if (z == 3)
+        {
+            if (y & 1)
+            {
+                snprintf(buf, size, "LD %s,(%04XH)", rp_z80[y >> 1], nn);
+            }
+            else
+            {
+                snprintf(buf, size, "LD (%04XH),%s", nn, rp_z80[y >> 1]);
+            }
+        }
+        else if (z == 4)
+        {
+            snprintf(buf, size, "NEG");
+        }
+        else if (z == 5)
+        {
+            snprintf(buf, size, (y == 1) ? "RETI" : "RETN");
+        }
+        else if (z == 6)
+        {
+            snprintf(buf, size, "IM %d", (y & 3) ? (y & 3) - 1 : 0);
+        }
+        else
+        {
+            snprintf(buf, size, "%s", x1z7_z80[y]);
+        }
+        return;
+    }
+
+    const uint32_t info = op_z80[op];
+    const uint32_t x = op >> 6;
+    const uint32_t y = (op >> 3) & 7;
+    const uint32_t z = op & 7;
+    const uint32_t p = y >> 1;
+    const uint32_t q = y & 1;
+    const char *hl = ix ? ix : "HL";
+    const char *r[8];
+    uint32_t n = code[i + 1];
+    uint32_t nn = code[i + 1] | (code[i + 2] << 8);
+
+    memcpy(r, r_z80, sizeof(r));
+    if (ix && ((info >> 2) & 1))
+    {
+        // operand bytes follow the displacement
+        snprintf(mem, sizeof(mem), "(%s%+d)", ix, (int8_t)code[i + 1]);
+        r[6] = mem;
+        n = code[i + 2];
+    }
+    const char *rp[4] = {rp_z80[0], rp_z80[1], hl, rp_z80[3]};
+
+    switch (x)
+    {
+    case 0:
+        switch (z)
+        {
+        case 0:
+            if (y == 0)
+            {
+                snprintf(buf, size, "NOP");
+            }
+            else if (y == 1)
+            {
+                snprintf(buf, size, "EX AF,AF'");
+            }
+            else
+            {
+                const uint32_t target = (pc + 2 + (int8_t)code[1]) & 0xffff;
+                if (y == 2)
+                {
+                    snprintf(buf, size, "DJNZ %04XH", target);
+                }
+                else if (y == 3)
+                {
+                    snprintf(buf, size, "JR %04XH", target);
+                }
+                else
+                {
+                    snprintf(buf, size, "JR %s,%04XH", cc_z80[y - 4], target);
+                }
+            }
+            break;
+        case 1:
+            if (q == 0)
+            {
+                snprintf(buf, size, "LD %s,%04XH", rp[p], nn);
+            }
+            else
+            {
+                snprintf(buf, size, "ADD %s,%s", hl, rp[p]);
+            }
+            break;
+        case 2:
+            {
+                static const char *ind[] = {"(BC)", "(DE)"};
+                char addr[8];
+                snprintf(addr, sizeof(addr), "(%04XH)", nn);
+                const char *reg = (p == 2) ? hl : "A";
+                const char *m = (p < 2) ? ind[p] : addr;
+                if (q == 0)
+                {
+                    snprintf(buf, size, "LD %s,%s", m, reg);
+                }
+                else
+                {
+                    snprintf(buf, size, "LD %s,%s", reg, m);
+                }
+            }
+            break;
+        case 3:
+            snprintf(buf, size, "%s %s", q ? "DEC" : "INC", rp[p]);
+            break;
+        case 4:
+            snprintf(buf, size, "INC %s", r[y]);
+            break;
+        case 5:
+            snprintf(buf, size, "DEC %s", r[y]);
+            break;
+        case 6:
+            snprintf(buf, size, "LD %s,%02XH", r[y], n);
+            break;
+        default:
+            snprintf(buf, size, "%s", x0z7_z80[y]);
+            break;
+        }
+        break;
+    case 1:
+        if (op == 0x76)
+        {
+            snprintf(buf, size, "HALT");
+        }
+        else
+        {
+            snprintf(buf, size, "LD %s,%s", r[y], r[z]);
+        }
+        break;
+    case 2:
+        snprintf(buf, size, "%s%s", alu_z80[y], r[z]);
+        break;
+    default:
+        switch (z)
+        {
+        case 0:
+            snprintf(buf, size, "RET %s", cc_z80[y]);
+            break;
+        case 1:
+            if (q == 0)
+            {
+                snprintf(buf, size, "POP %s", (p == 2) ? hl : rp2_z80[p]);
+            }
+            else if (p == 0)
+            {
+                snprintf(buf, size, "RET");
+            }
+            else if (p == 1)
+            {
+                snprintf(buf, size, "EXX");
+            }
+            else if (p == 2)
+            {
+                snprintf(buf, size, "JP (%s)", hl);
+            }
+            else
+            {
+                snprintf(buf, size, "LD SP,%s", hl);
+            }
+            break;
+        case 2:
+            snprintf(buf, size, "JP %s,%04XH", cc_z80[y], nn);
+            break;
+        case 3:
+            if (y == 0)
+            {
+                snprintf(buf, size, "JP %04XH", nn);
+            }
+            else if (y == 4)
+            {
+                snprintf(buf, size, "EX (SP),%s", hl);
+            }
+            else
+            {
+                snprintf(buf, size, x3z3_z80[y], n);
+            }
+            break;
+        case 4:
+            snprintf(buf, size, "CALL %s,%04XH", cc_z80[y], nn);
+            break;
+        case 5:
+            if (q == 0)
+            {
+                snprintf(buf, size, "PUSH %s", (p == 2) ? hl : rp2_z80[p]);
+            }
+            else
+            {
+                snprintf(buf, size, "CALL %04XH", nn);
+            }
+            break;
+        case 6:
+            snprintf(buf, size, "%s%02XH", alu_z80[y], n);
+            break;
+        default:
+            snprintf(buf, size, "RST %02XH", y * 8);
+            break;
+        }
+        break;
+    }
+}
+
+//
+// 6809
+//
+typedef enum mode_6809
+{
+    M6809_INH, M6809_IMM8, M6809_IMM16, M6809_DIR, M6809_IDX, M6809_EXT,
+    M6809_REL8, M6809_REL16, M6809_STK, M6809_TFR,
+} mode_6809_e;
+
+typedef struct
+{
+    uint8_t op;
+    uint16_t info;
+} op_6809_ext_t;
+
+static const uint8_t len_6809[] = {0, 1, 2, 1, 1, 2, 1, 2, 1, 1};
+// extra bytes after the indexed postbyte (by low nibble, bit 7 set)
+static const uint8_t idx_len_6809[16] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 0, 0, 1, 2, 0, 2};
+
+static const uint16_t op_6809[256] =
+{
+    0x135d, 0x0000, 0x0000, 0x132d, 0x1359, 0x0000, 0x136b, 0x130d,
+    0x130a, 0x1368, 0x1332, 0x0000, 0x1338, 0x1382, 0x033b, 0x0323,
+    0x0000, 0x0000, 0x0060, 0x0080, 0x0000, 0x0000, 0x0749, 0x074b,
+    0x0000, 0x0031, 0x0163, 0x0000, 0x0109, 0x0072, 0x0937, 0x0981,
+    0x061e, 0x061f, 0x0615, 0x0619, 0x0610, 0x0611, 0x061c, 0x0612,
+    0x0621, 0x0622, 0x061d, 0x061b, 0x0613, 0x061a, 0x0614, 0x0618,
+    0x0457, 0x0458, 0x0455, 0x0456, 0x0864, 0x3866, 0x0865, 0x3867,
+    0x0000, 0x206f, 0x0001, 0x306e, 0x0130, 0x005c, 0x0000, 0x207d,
+    0x005e, 0x0000, 0x0000, 0x002e, 0x005a, 0x0000, 0x006c, 0x000e,
+    0x000b, 0x0069, 0x0033, 0x0000, 0x0039, 0x0083, 0x0000, 0x0024,
+    0x005f, 0x0000, 0x0000, 0x002f, 0x005b, 0x0000, 0x006d, 0x000f,
+    0x000c, 0x006a, 0x0034, 0x0000, 0x003a, 0x0084, 0x0000, 0x0025,
+    0x145d, 0x0000, 0x0000, 0x142d, 0x1459, 0x0000, 0x146b, 0x140d,
+    0x140a, 0x1468, 0x1432, 0x0000, 0x1438, 0x1482, 0x043b, 0x0423,
+    0x155d, 0x0000, 0x0000, 0x152d, 0x1559, 0x0000, 0x156b, 0x150d,
+    0x150a, 0x1568, 0x1532, 0x0000, 0x1538, 0x1582, 0x053b, 0x0523,
+    0x017a, 0x0126, 0x0170, 0x027c, 0x0107, 0x0116, 0x014e, 0x0000,
+    0x0135, 0x0102, 0x0161, 0x0104, 0x022b, 0x0620, 0x0253, 0x0000,
+    0x137a, 0x1326, 0x1370, 0x237c, 0x1307, 0x1316, 0x134e, 0x0373,
+    0x1335, 0x1302, 0x1361, 0x1304, 0x232b, 0x033c, 0x2353, 0x0378,
+    0x147a, 0x1426, 0x1470, 0x247c, 0x1407, 0x1416, 0x144e, 0x0473,
+    0x1435, 0x1402, 0x1461, 0x1404, 0x242b, 0x043c, 0x2453, 0x0478,
+    0x157a, 0x1526, 0x1570, 0x257c, 0x1507, 0x1516, 0x154e, 0x0573,
+    0x1535, 0x1502, 0x1561, 0x1504, 0x252b, 0x053c, 0x2553, 0x0578,
+    0x017b, 0x0127, 0x0171, 0x0206, 0x0108, 0x0117, 0x014f, 0x0000,
+    0x0136, 0x0103, 0x0162, 0x0105, 0x0250, 0x0000, 0x0252, 0x0000,
+    0x137b, 0x1327, 0x1371, 0x2306, 0x1308, 0x1317, 0x134f, 0x0374,
+    0x1336, 0x1303, 0x1362, 0x1305, 0x2350, 0x0375, 0x2352, 0x0377,
+    0x147b, 0x1427, 0x1471, 0x2406, 0x1408, 0x1417, 0x144f, 0x0474,
+    0x1436, 0x1403, 0x1462, 0x1405, 0x2450, 0x0475, 0x2452, 0x0477,
+    0x157b, 0x1527, 0x1571, 0x2506, 0x1508, 0x1517, 0x154f, 0x0574,
+    0x1536, 0x1503, 0x1562, 0x1505, 0x2550, 0x0575, 0x2552, 0x0577,
+};
+
+static const op_6809_ext_t op_6809_10[] =
+{
+    {0x21, 0x074a}, {0x22, 0x0742}, {0x23, 0x0744}, {0x24, 0x073d},
+    {0x25, 0x073e}, {0x26, 0x0747}, {0x27, 0x073f}, {0x28, 0x074c},
+    {0x29, 0x074d}, {0x2a, 0x0748}, {0x2b, 0x0746}, {0x2c, 0x0740},
+    {0x2d, 0x0745}, {0x2e, 0x0741}, {0x2f, 0x0743}, {0x3f, 0x207e},
+    {0x83, 0x0228}, {0x8c, 0x022c}, {0x8e, 0x0254}, {0x93, 0x2328},
+    {0x9c, 0x232c}, {0x9e, 0x2354}, {0x9f, 0x0379}, {0xa3, 0x2428},
+    {0xac, 0x242c}, {0xae, 0x2454}, {0xaf, 0x0479}, {0xb3, 0x2528},
+    {0xbc, 0x252c}, {0xbe, 0x2554}, {0xbf, 0x0579}, {0xce, 0x0251},
+    {0xde, 0x2351}, {0xdf, 0x0376}, {0xee, 0x2451}, {0xef, 0x0476},
+    {0xfe, 0x2551}, {0xff, 0x0576},
+};
+
+static const op_6809_ext_t op_6809_11[] =
+{
+    {0x3f, 0x207f}, {0x83, 0x022a}, {0x8c, 0x0229}, {0x93, 0x232a},
+    {0x9c, 0x2329}, {0xa3, 0x242a}, {0xac, 0x2429}, {0xb3, 0x252a},
+    {0xbc, 0x2529},
+};
+
+static const char mn_6809[][6] =
+{
+    "???", "ABX", "ADCA", "ADCB", "ADDA", "ADDB", "ADDD", "ANDA",
+    "ANDB", "ANDCC", "ASL", "ASLA", "ASLB", "ASR", "ASRA", "ASRB",
+    "BCC", "BCS", "BEQ", "BGE", "BGT", "BHI", "BITA", "BITB",
+    "BLE", "BLS", "BLT", "BMI", "BNE", "BPL", "BRA", "BRN",
+    "BSR", "BVC", "BVS", "CLR", "CLRA", "CLRB", "CMPA", "CMPB",
+    "CMPD", "CMPS", "CMPU", "CMPX", "CMPY", "COM", "COMA", "COMB",
+    "CWAI", "DAA", "DEC", "DECA", "DECB", "EORA", "EORB", "EXG",
+    "INC", "INCA", "INCB", "JMP", "JSR", "LBCC", "LBCS", "LBEQ",
+    "LBGE", "LBGT", "LBHI", "LBLE", "LBLS", "LBLT", "LBMI", "LBNE",
+    "LBPL", "LBRA", "LBRN", "LBSR", "LBVC", "LBVS", "LDA", "LDB",
+    "LDD", "LDS", "LDU", "LDX", "LDY", "LEAS", "LEAU", "LEAX",
+    "LEAY", "LSR", "LSRA", "LSRB", "MUL", "NEG", "NEGA", "NEGB",
+    "NOP", "ORA", "ORB", "ORCC", "PSHS", "PSHU", "PULS", "PULU",
+    "ROL", "ROLA", "ROLB", "ROR", "RORA", "RORB", "RTI", "RTS",
+    "SBCA", "SBCB", "SEX", "STA", "STB", "STD", "STS", "STU",
+    "STX", "STY", "SUBA", "SUBB", "SUBD", "SWI", "SWI2", "SWI3",
+    "SYNC", "TFR", "TST", "TSTA", "TSTB",
+};
+
+// opcode info and its size (1: page 0, 2: page 2/3 prefix)
+static uint32_t info_6809(const uint8_t *code, uint32_t *size)
+{
+    const op_6809_ext_t *table;
+    uint32_t num;
+
+    if ((code[0] != 0x10) && (code[0] != 0x11))
+    {
+        *size = 1;
+        return op_6809[code[0]];
+    }
+    *size = 2;
+    table = (code[0] == 0x10) ? op_6809_10 : op_6809_11;
+    num = (code[0] == 0x10) ? sizeof(op_6809_10) / sizeof(op_6809_10[0]) : sizeof(op_6809_11) / sizeof(op_6809_11[0]);
+    for (uint32_t i = 0; i < num; i++)
+    {
+        if (table[i].op == code[1])
+        {
+            return table[i].info;
+        }
+    }
+    return 0;
+}
+
+static uint32_t length_6809(const uint8_t *code, uint32_t count)
+{
+    uint32_t size;
+    uint32_t info;
+
+    if (((code[0] == 0x10) || (code[0] == 0x11)) && (count < 2))
+    {
+        return 0;
+    }
+    info = info_6809(code, &size);
+    if ((info & 0xff) == 0)
+    {
+        return size;
+    }
+    const uint32_t mode = (info >> 8) & 0xf;
+    if (mode == M6809_IDX)
+    {
+        if (count < size + 1)
+        {
+            return 0;
+        }
+        const uint32_t post = code[size];
+        return size + 1 + ((post & 0x80) ? idx_len_6809[post & 0xf] : 0);
+    }
+    return size + len_6809[mode];
+}
+
+static uint32_t data_reads_6809(const uint8_t *code)
+{
+    uint32_t size;
+    const uint32_t info = info_6809(code, &size);
+    uint32_t reads = (info >> 12) & 3;
+
+    // indirect: pointer is read first
+    if ((((info >> 8) & 0xf) == M6809_IDX) && ((code[size] & 0x90) == 0x90))
+    {
+        reads += 2;
+    }
+    return reads;
+}
+
+static void format_6809(const uint8_t *code, uint32_t pc, char *buf, size_t size)
+{
+    static const char *reg_idx = "XYUS";
+    static const char *reg_tfr[16] = {"D", "X", "Y", "U", "S", "PC", "?", "?", "A", "B", "CC", "DP", "?", "?", "?", "?"};
+    uint32_t op_size;
+    const uint32_t info = info_6809(code, &op_size);
+    const uint32_t mode = (info >> 8) & 0xf;
+    const uint8_t *operand = code + op_size;
+    const char *mn = mn_6809[info & 0xff];
+    const uint32_t len = length_6809(code, DISASM_MAX_BYTES);
+    const uint32_t value8 = operand[0];
+    const uint32_t value16 = (operand[0] << 8) | operand[1];
+
+    switch (mode)
+    {
+    case M6809_INH:
+        snprintf(buf, size, "%s", mn);
+        break;
+    case M6809_IMM8:
+        snprintf(buf, size, "%s #$%02X", mn, value8);
+        break;
+    case M6809_IMM16:
+        snprintf(buf, size, "%s #$%04X", mn, value16);
+        break;
+    case M6809_DIR:
+        snprintf(buf, size, "%s <$%02X", mn, value8);
+        break;
+    case M6809_EXT:
+        snprintf(buf, size, "%s $%04X", mn, value16);
+        break;
+    case M6809_REL8:
+        snprintf(buf, size, "%s $%04X", mn, (pc + len + (int8_t)value8) & 0xffff);
+        break;
+    case M6809_REL16:
+        snprintf(buf, size, "%s $%04X", mn, (pc + len + value16) & 0xffff);
+        break;
+    case M6809_STK:
+        {
+            // PSHS/PULS: bit 6 is U, PSHU/PULU: bit 6 is S
+            static const char *reg_stk[8] = {"CC", "A", "B", "DP", "X", "Y", "U", "PC"};
+            int32_t pos = snprintf(buf, size, "%s ", mn);
+            for (uint32_t i = 0; i < 8; i++)
+            {
+                if ((value8 & (1 << i)) && (pos < (int32_t)size))
+                {
+                    const char *reg = ((i == 6) && (code[0] & 2)) ? "S" : reg_stk[i];
+                    pos += snprintf(buf + pos, size - pos, "%s%s", (value8 & ((1 << i) - 1)) ? "," : "", reg);
+                }
+            }
+        }
+        break;
+    case M6809_TFR:
+        snprintf(buf, size, "%s %s,%s", mn, reg_tfr[value8 >> 4], reg_tfr[value8 & 0xf]);
+        break;
+    default:
+        {
+            const uint32_t post = operand[0];
+            const char reg = reg_idx[(post >> 5) & 3];
+            const uint32_t n8 = operand[1];
+            const uint32_t n16 = (operand[1] << 8) | operand[2];
+            char ea[16];
+            if ((post & 0x80) == 0)
+            {
+                // 5 bit offset
+                snprintf(buf, size, "%s %d,%c", mn, (int32_t)((post & 0x1f) ^ 0x10) - 0x10, reg);
+                break;
+            }
+            switch (post & 0xf)
+            {
+            case 0x0: snprintf(ea, sizeof(ea), ",%c+", reg); break;
+            case 0x1: snprintf(ea, sizeof(ea), ",%c++", reg); break;
+            case 0x2: snprintf(ea, sizeof(ea), ",-%c", reg); break;
+            case 0x3: snprintf(ea, sizeof(ea), ",--%c", reg); break;
+            case 0x4: snprintf(ea, sizeof(ea), ",%c", reg); break;
+            case 0x5: snprintf(ea, sizeof(ea), "B,%c", reg); break;
+            case 0x6: snprintf(ea, sizeof(ea), "A,%c", reg); break;
+            case 0x8: snprintf(ea, sizeof(ea), "%d,%c", (int8_t)n8, reg); break;
+            case 0x9: snprintf(ea, sizeof(ea), "%d,%c", (int16_t)n16, reg); break;
+            case 0xb: snprintf(ea, sizeof(ea), "D,%c", reg); break;
+            case 0xc: snprintf(ea, sizeof(ea), "$%04X,PCR", (pc + len + (int8_t)n8) & 0xffff); break;
+            case 0xd: snprintf(ea, sizeof(ea), "$%04X,PCR", (pc + len + n16) & 0xffff); break;
+            case 0xf: snprintf(ea, sizeof(ea), "$%04X", n16); break;
+            default: snprintf(ea, sizeof(ea), "?"); break;
+            }
+            snprintf(buf, size, (post & 0x10) ? "%s [%s]" : "%s %s", mn, ea);
+        }
+        break;
+    }
+}
+
+//
+// interface
+//
+const char *disasm_cpu_name(disasm_cpu_e cpu)
+{
+    return disasm_cpu_names[cpu];
+}
+
+bool disasm_cpu_find(const char *name, disasm_cpu_e *cpu)
+{
+    for (uint32_t i = 0; i < DISASM_CPU_NUM; i++)
+    {
+        if (strcmp(name, disasm_cpu_names[i]) == 0)
+        {
+            *cpu = (disasm_cpu_e)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t disasm_length(disasm_cpu_e cpu, const uint8_t *code, uint32_t count)
+{
+    switch (cpu)
+    {
+    case DISASM_6502:
+        return length_6502(code);
+    case DISASM_Z80:
+        return length_z80(code, count);
+    default:
+        return length_6809(code, count);
+    }
+}
+
+uint32_t disasm_data_reads(disasm_cpu_e cpu, const uint8_t *code)
+{
+    switch (cpu)
+    {
+    case DISASM_6502:
+        return (op_6502[code[0]] >> 10) & 3;
+    case DISASM_Z80:
+        return data_reads_z80(code);
+    default:
+        return data_reads_6809(code);
+    }
+}
+
+bool disasm_is_dummy(disasm_cpu_e cpu, uint32_t addr)
+{
+    return (cpu == DISASM_6809) && (addr == 0xffff);
+}
+
+void disasm_format(disasm_cpu_e cpu, const uint8_t *code, uint32_t pc, char *buf, size_t size)
+{
+    switch (cpu)
+    {
+    case DISASM_6502:
+        format_6502(code, pc, buf, size);
+        break;
+    case DISASM_Z80:
+        format_z80(code, pc, buf, size);
+        break;
+    default:
+        format_6809(code, pc, buf, size);
+        break;
+    }
+}
@@ -0,0 +1,34 @@
+/*
+ * Copyright (c) 2024 Hirokuni Yano
+ *
+ * Released under the MIT license.
+ * see https://opensource.org/licenses/MIT
+ */
+#ifndef DISASM_H__
+#define DISASM_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum disasm_cpu
+{
+    DISASM_6502,
+    DISASM_Z80,
+    DISASM_6809,
+    DISASM_CPU_NUM,
+} disasm_cpu_e;
+
+#define DISASM_MAX_BYTES 5
+
+const char *disasm_cpu_name(disasm_cpu_e cpu);
+bool disasm_cpu_find(const char *name, disasm_cpu_e *cpu);
+// instruction length from the first count bytes (0: more bytes needed)
+uint32_t disasm_length(disasm_cpu_e cpu, const uint8_t *code, uint32_t count);
+// reads of data memory that may follow the operands
+uint32_t disasm_data_reads(disasm_cpu_e cpu, const uint8_t *code);
+// address of bus cycles without a valid access (6809: $ffff)
+bool disasm_is_dummy(disasm_cpu_e cpu, uint32_t addr);
+void disasm_format(disasm_cpu_e cpu, const uint8_t *code, uint32_t pc, char *buf, size_t size);
+
+#endif
@@ -7,10 +7,27 @@
 #include <stdint.h>
 #include "hardware/pio.h"
 #include "hardware/dma.h"
+#include "hardware/gpio.h"
+#include "hardware/sync.h"
+#include "hardware/timer.h"
 #include "section.h"
 
 #include "romemu.pio.h"
 
+static PIO romemu_io_pio;
+static uint romemu_io_sm;
+static uint romemu_pin;
+static uint32_t romemu_slot = 0;
+
+static uint32_t romemu_rev16(uint32_t v)
+{
+    uint32_t r = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        r = (r << 1) | ((v >> i) & 1);
+    }
+    return r;
+}
 
 static void romemu_io_init(PIO pio, uint sm, uint offset, uint pin, uint8_t *rom)
 {
@@ -31,8 +48,34 @@ static void romemu_io_init(PIO pio, uint sm, uint offset, uint pin, uint8_t *rom
     pio_sm_init(pio, sm, offset + romemu_io_offset_entry_point, &c);
     pio_sm_set_enabled(pio, sm, true);
 
+    // slot 1 base is kept bit reversed in the upper half, 'mov x, ::y' selects it
     uint32_t romaddr_top = (uint32_t)rom >> romemu_io_addr_bus_width;
-    pio_sm_put_blocking(pio, sm, romaddr_top);
+    pio_sm_put_blocking(pio, sm, (romemu_rev16(romaddr_top + 1) << 16) | romaddr_top);
+}
+
+static void romemu_ext_init(PIO pio, uint sm, uint offset, uint pin, uint ext_pin, uint8_t *lower, uint8_t *upper)
+{
+    const uint pin_addr = pin + romemu_ext_addr_bus_offset;
+    const uint pin_data = pin + romemu_ext_data_bus_offset;
+    for (uint i = 0; i < romemu_ext_data_bus_width; i++)
+    {
+        pio_gpio_init(pio, pin_data + i);
+    }
+    pio_sm_set_consecutive_pindirs(pio, sm, pin_addr, romemu_ext_addr_bus_width, false);
+    pio_sm_set_consecutive_pindirs(pio, sm, pin_data, romemu_ext_data_bus_width, false);
+    pio_sm_set_consecutive_pindirs(pio, sm, ext_pin, 1, false);
+    pio_sm_config c = romemu_ext_program_get_default_config(offset);
+    sm_config_set_in_pins(&c, pin_addr);
+    sm_config_set_in_shift(&c, true, true, 32);
+    sm_config_set_out_pins(&c, pin_data, romemu_ext_data_bus_width);
+    sm_config_set_out_shift(&c, true, true, 8);
+    sm_config_set_jmp_pin(&c, ext_pin);
+    sm_config_set_clkdiv_int_frac(&c, 1, 0);
+    pio_sm_init(pio, sm, offset + romemu_ext_offset_entry_point, &c);
+    pio_sm_set_enabled(pio, sm, true);
+
+    pio_sm_put_blocking(pio, sm, (uint32_t)lower >> romemu_ext_addr_bus_width);
+    pio_sm_put_blocking(pio, sm, (uint32_t)upper >> romemu_ext_addr_bus_width);
 }
 
 static void romemu_oe_init(PIO pio, uint sm, uint offset, uint pin)
@@ -52,13 +95,27 @@ static void romemu_oe_init(PIO pio, uint sm, uint offset, uint pin)
 }
 
 
-void romemu_init(PIO pio, uint pin, uint8_t *rom)
+// rom must be 128KiB aligned. slot 1 is the 64KiB image just after rom.
+// ext_pin >= 0: the image is selected by ext_pin per bus cycle (no swap).
+void romemu_init(PIO pio, uint pin, uint8_t *rom, int32_t ext_pin)
 {
     dma_channel_config c;
 
-    uint offset_romemu_io = pio_add_program(pio, &romemu_io_program);
     uint sm_romemu_io = pio_claim_unused_sm(pio, true);
-    romemu_io_init(pio, sm_romemu_io, offset_romemu_io, pin, rom);
+    if (ext_pin < 0)
+    {
+        uint offset_romemu_io = pio_add_program(pio, &romemu_io_program);
+        romemu_io_init(pio, sm_romemu_io, offset_romemu_io, pin, rom);
+    }
+    else
+    {
+        uint offset_romemu_ext = pio_add_program(pio, &romemu_ext_program);
+        romemu_ext_init(pio, sm_romemu_io, offset_romemu_ext, pin, ext_pin, rom, rom + 0x10000);
+    }
+    romemu_io_pio = pio;
+    romemu_io_sm = sm_romemu_io;
+    romemu_pin = pin;
+    romemu_slot = 0;
 
     uint offset_oe = pio_add_program(pio, &romemu_oe_program);
     uint sm_oe = pio_claim_unused_sm(pio, true);
@@ -98,3 +155,47 @@ void romemu_init(PIO pio, uint pin, uint8_t *rom)
 
     dma_channel_start(dma_addr);
 }
+
+#define ROMEMU_SELECT_TIMEOUT_US    100000
+#define ROMEMU_SELECT_POLL_US       20      // interrupts are disabled per poll window
+
+// switch the image between bus cycles: the CPU polls /CE and /OE and changes the
+// base register while either is inactive (the SM keeps serving meanwhile)
+void romemu_select(uint32_t slot)
+{
+    const PIO pio = romemu_io_pio;
+    const uint sm = romemu_io_sm;
+    const uint32_t idle = (1u << (romemu_pin + romemu_io_ce_pin_offset)) | (1u << (romemu_pin + romemu_io_oe_pin_offset));
+    const uint instr = (slot & 1) ? pio_encode_mov_reverse(pio_x, pio_y) : pio_encode_mov(pio_x, pio_y);
+    const uint32_t start = time_us_32();
+
+    romemu_slot = slot & 1;
+    while (true)
+    {
+        // no IRQ between the pin check and the exec
+        const uint32_t ints = save_and_disable_interrupts();
+        const uint32_t poll = time_us_32();
+        do
+        {
+            if ((gpio_get_all() & idle) != 0)
+            {
+                pio_sm_exec(pio, sm, instr);
+                restore_interrupts(ints);
+                return;
+            }
+        } while (time_us_32() - poll < ROMEMU_SELECT_POLL_US);
+        if (time_us_32() - start >= ROMEMU_SELECT_TIMEOUT_US)
+        {
+            // /CE and /OE tied active: unsynchronised switch
+            pio_sm_exec(pio, sm, instr);
+            restore_interrupts(ints);
+            return;
+        }
+        restore_interrupts(ints);
+    }
+}
+
+uint32_t romemu_selected(void)
+{
+    return romemu_slot;
+}
@@ -10,6 +10,8 @@
 #include <stdint.h>
 #include "hardware/pio.h"
 
-void romemu_init(PIO pio, uint pin, uint8_t *rom);
+void romemu_init(PIO pio, uint pin, uint8_t *rom, int32_t ext_pin);
+void romemu_select(uint32_t slot);
+uint32_t romemu_selected(void);
 
 #endif
@@ -0,0 +1,118 @@
+/*
+ * Copyright (c) 2024 Hirokuni Yano
+ *
+ * Released under the MIT license.
+ * see https://opensource.org/licenses/MIT
+ */
+#include <stdint.h>
+#include "hardware/clocks.h"
+#include "hardware/gpio.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+
+#include "romread.pio.h"
+
+// /OE to sample: (delay + 2) cycles, address to sample is one cycle more (see romread.pio)
+#define ROMREAD_DELAY_OVERHEAD (2)
+
+static PIO romread_pio;
+static uint romread_sm;
+static uint romread_offset;
+static uint romread_pin;
+static int romread_dma_ch;
+
+static void romread_io_init(PIO pio, uint sm, uint offset, uint pin)
+{
+    pio_sm_config c = romread_io_program_get_default_config(offset);
+    sm_config_set_out_pins(&c, pin + romread_io_addr_bus_offset, romread_io_addr_bus_width);
+    sm_config_set_sideset_pins(&c, pin + romread_io_oe_pin_offset);
+    sm_config_set_in_pins(&c, pin + romread_io_data_bus_offset);
+    sm_config_set_in_shift(&c, false, true, romread_io_data_bus_width);
+    sm_config_set_out_shift(&c, true, false, 32);
+    sm_config_set_clkdiv_int_frac(&c, 1, 0);
+    pio_sm_init(pio, sm, offset + romread_io_offset_entry_point, &c);
+}
+
+void romread_init(PIO pio, uint pin)
+{
+    romread_pio = pio;
+    romread_pin = pin;
+    romread_offset = pio_add_program(pio, &romread_io_program);
+    romread_sm = pio_claim_unused_sm(pio, true);
+    romread_io_init(pio, romread_sm, romread_offset, pin);
+
+    romread_dma_ch = dma_claim_unused_channel(true);
+}
+
+uint32_t romread_ns_to_delay(uint32_t ns)
+{
+    const uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+    const uint32_t cycles = ((uint64_t)ns * mhz + 999) / 1000;
+
+    return (cycles > ROMREAD_DELAY_OVERHEAD) ? (cycles - ROMREAD_DELAY_OVERHEAD) : 0;
+}
+
+uint32_t romread_delay_to_ns(uint32_t delay)
+{
+    const uint32_t mhz = clock_get_hz(clk_sys) / 1000000;
+
+    return ((delay + ROMREAD_DELAY_OVERHEAD) * 1000) / mhz;
+}
+
+void romread_read(uint8_t *dst, uint32_t start, uint32_t end, uint32_t delay)
+{
+    PIO pio = romread_pio;
+    const uint sm = romread_sm;
+    const uint pin_addr = romread_pin + romread_io_addr_bus_offset;
+    const uint pin_oe = romread_pin + romread_io_oe_pin_offset;
+    const uint32_t mask_addr = ((1u << romread_io_addr_bus_width) - 1) << pin_addr;
+    const uint32_t mask_oe = 1u << pin_oe;
+
+    if (end <= start)
+    {
+        return;
+    }
+
+    pio_sm_set_enabled(pio, sm, false);
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_restart(pio, sm);
+    pio_sm_exec(pio, sm, pio_encode_jmp(romread_offset + romread_io_offset_entry_point));
+
+    // take over A0-A15 and /OE from SIO (/OE = 1)
+    pio_sm_set_pins_with_mask(pio, sm, mask_oe, mask_addr | mask_oe);
+    pio_sm_set_pindirs_with_mask(pio, sm, mask_addr | mask_oe, mask_addr | mask_oe);
+    for (uint i = 0; i < romread_io_addr_bus_width; i++)
+    {
+        pio_gpio_init(pio, pin_addr + i);
+    }
+    pio_gpio_init(pio, pin_oe);
+
+    dma_channel_config c = dma_channel_get_default_config(romread_dma_ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_dreq(&c, pio_get_dreq(pio, sm, false));
+    dma_channel_configure(
+        romread_dma_ch,
+        &c,
+        &dst[start],
+        &pio->rxf[sm],
+        end - start,
+        true
+    );
+
+    pio_sm_put(pio, sm, ~start);
+    pio_sm_put(pio, sm, delay);
+    pio_sm_set_enabled(pio, sm, true);
+
+    dma_channel_wait_for_finish_blocking(romread_dma_ch);
+
+    pio_sm_set_enabled(pio, sm, false);
+
+    // give A0-A15 and /OE back to SIO
+    for (uint i = 0; i < romread_io_addr_bus_width; i++)
+    {
+        gpio_set_function(pin_addr + i, GPIO_FUNC_SIO);
+    }
+    gpio_set_function(pin_oe, GPIO_FUNC_SIO);
+}
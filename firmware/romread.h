@@ -0,0 +1,18 @@
+/*
+ * Copyright (c) 2024 Hirokuni Yano
+ *
+ * Released under the MIT license.
+ * see https://opensource.org/licenses/MIT
+ */
+#ifndef ROMREAD_H__
+#define ROMREAD_H__
+
+#include <stdint.h>
+#include "hardware/pio.h"
+
+void romread_init(PIO pio, uint pin);
+uint32_t romread_ns_to_delay(uint32_t ns);
+uint32_t romread_delay_to_ns(uint32_t delay);
+void romread_read(uint8_t *dst, uint32_t start, uint32_t end, uint32_t delay);
+
+#endif
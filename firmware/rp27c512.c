@@ -24,18 +24,22 @@
 
 #include "microrl.h"
 #include "xmodem.h"
+#include "ymodem.h"
 #include "readline.h"
 #include "section.h"
 
 #include "busmon.h"
 #include "romemu.h"
+#include "romread.h"
+#include "disasm.h"
 
 // #define DEBUG_PULL_UP
 
 #define ARRAY_SIZE(array) (sizeof(array) / sizeof(array[0]))
 
 //                /0123456789ABCDEF
-#define MAGIC_STR "RP27C512 VER1.00"
+#define MAGIC_STR "RP27C512 VER1.10"
+#define MAGIC_STR_V100 "RP27C512 VER1.00"   // capture_target bitmap in config
 #define MAGIC_SIZE (16)
 
 #define GPIO_ADDR 0
@@ -69,22 +73,74 @@
 #define FLASH_WAIT_MS               (500)
 #define DEFAULT_CLONE_WAIT_S        (5)
 #define DEFAULT_CLONE_VERIFY_NUM    (2)
+#define DEFAULT_CLONE_ACCESS_NS     (250)
 #define DEFAULT_DUMP_LINE_COUNT     (16)
 
 #define CONFIG_ERASE_SIZE           (FLASH_SECTOR_SIZE * 3)
 #define CONFIG_WRITE_SIZE           (FLASH_PAGE_SIZE * (1 + 32))
 
-static uint8_t __memimage(rom[0x10000]) __attribute__((aligned(0x10000)));;
-static uint8_t __memimage(ram[0x10000]) __attribute__((aligned(0x10000)));;
+// rom and ram form one 128KiB block (romemu serves either of them as the image slot),
+// the linker script places .memimage.ram right after .memimage.rom and checks it
+static uint8_t __memimage(rom[0x10000]) __attribute__((aligned(0x20000)));
+static uint8_t __memimage(ram[0x10000]) __attribute__((aligned(0x10000)));
 static uint8_t *device = rom;
+static uint32_t send_size = sizeof(rom);
 
 static uint8_t __noinit(init_rom_data[FLASH_PAGE_SIZE]);
 
 #define CAPTURE_COUNT 8192
-static uint32_t __noinit(capture_buffer[CAPTURE_COUNT]);
-static volatile uint32_t capture_wp = 0;
+// run record (capmode rle): sequential reads from the address in bits 0-15
+#define CAPTURE_RUN         0x40000000
+#define CAPTURE_RUN_LEN     0x00ff0000  // reads of the run (in place of the data)
+#define CAPTURE_RUN_LEN_SHIFT 16
+#define CAPTURE_CTRL        0x0f000000  // EXT, /CE
+#define CAPTURE_RUN_FLUSH_US 100        // idle time until a pending run is stored
+// lost record: events lost before core1 stored them (DMA ring lapped or PIO stall)
+#define CAPTURE_LOST        0x80000000
+#define CAPTURE_LOST_STALL  0x00010000  // PIO stalled: count unknown
+#define CAPTURE_LOST_COUNT  0x0000ffff  // records overwritten in the DMA ring (saturated)
+
+#define COV_BLOCK_SIZE 8                // address range of a hot counter
+
+#define CLONE_VOTE_MAX_PASS (15)
+#define CLONE_VOTE_COUNT (2048)
+typedef struct
+{
+    uint16_t addr;
+    uint32_t ones; // 4bit counter x 8 (D0-D7)
+} clone_vote_t;
+
+// capture buffer (emulator/snoop) and clone work tables share the same memory
+typedef union
+{
+    uint32_t capture_buffer[CAPTURE_COUNT];
+    // capmode cov
+    struct
+    {
+        uint32_t read[0x10000 / 32];
+        uint32_t write[0x10000 / 32];
+        uint16_t count[0x10000 / COV_BLOCK_SIZE];   // reads (saturating)
+    } cov;
+    struct
+    {
+        uint8_t unstable[0x10000 / 8];
+        clone_vote_t vote[CLONE_VOTE_COUNT];
+    } clone;
+} work_area_u;
+
+static work_area_u __noinit(work_area);
+static volatile uint32_t capture_wp = 0;   // sequence number (free running)
 static uint32_t capture_rp = 0;
-static uint8_t __noinit(capture_target[0x10000 / 8]);
+static uint32_t capture_lost = 0;
+static bool capture_deep = false;
+static uint32_t capture_record_words = 1;   // 2: with timestamp
+static bool capture_rle = false;
+static bool capture_cov = false;            // work_area holds coverage, not capture
+static bool capture_filter_pio = false;     // capfilt applied in PIO
+static uint32_t capture_filter_mask = 0;    // capfilt applied in core1 (fcmd on)
+static uint32_t capture_filter_block = 0;
+static uint32_t __noinit(capture_target[0x10000 / 32]);
+static uint64_t capture_target_summary;     // any address watched in each 1KiB
 
 #define CONFIG_BANK_BLOCK (31)
 static const uint32_t FLASH_TARGET_OFFSET_CONFIG = (CONFIG_BANK_BLOCK * 0x10000);
@@ -112,6 +168,7 @@ typedef enum config_mode
     CONFIG_MODE_EMULATOR = 0,
     CONFIG_MODE_SNOOP,
     CONFIG_MODE_CLONE,
+    CONFIG_MODE_SRAM,
     CONFIG_MODE_NUM
 } config_mode_e;
 
@@ -123,6 +180,18 @@ typedef struct
     uint32_t pulldown;
 } gpio_config_t;
 
+#define WATCH_PROFILE_NUM 8
+#define WATCH_RANGE_MAX 128
+#define WATCH_NAME_SIZE 12
+
+// capture area saved as a sorted list of ranges
+typedef struct
+{
+    char            name[WATCH_NAME_SIZE];  // "": unused
+    uint32_t        count;
+    uint16_t        range[WATCH_RANGE_MAX][2];  // start, end
+} watch_profile_t;
+
 typedef struct
 {
     char            magic[MAGIC_SIZE];
@@ -130,14 +199,39 @@ typedef struct
     int32_t         rom_bank;
     int32_t         dump_line_count;
     gpio_config_t   gpio_config;
-    uint8_t         capture_target[0x10000 / 8];
+    int32_t         ext_bank_pin;   // 0: off, 1-3: EXT0-EXT2 selects the image
+    int32_t         ext_bank_upper; // flash rom bank for the image selected by EXT=1
+    int32_t         sram_wp_start;  // write protected block of sram mode
+    int32_t         sram_wp_size;   // 0: none
+    int32_t         flash_emu_type; // flash rom command set emulation (emulator mode)
+    int32_t         capture_deep;   // DMA writes the capture buffer directly
+    int32_t         capture_ts;     // timestamp after each captured access
+    int32_t         capture_filter_start;   // address block filtered in PIO
+    int32_t         capture_filter_size;    // 0: none
+    int32_t         capture_rle;    // collapse sequential reads into run records
+    int32_t         capture_cov;    // coverage bitmaps and hot counters instead of capture
+    int32_t         watch_profile;  // loaded at boot
+    watch_profile_t watch[WATCH_PROFILE_NUM];
 } config_t;
 
+// released VER1.00 layout: ends at the bitmap
+typedef struct
+{
+    char            magic[MAGIC_SIZE];
+    config_mode_e   mode;
+    int32_t         rom_bank;
+    int32_t         dump_line_count;
+    gpio_config_t   gpio_config;
+    uint8_t         capture_target[0x10000 / 8];
+} config_v100_t;
+
 typedef union
 {
     config_t cfg;
+    config_v100_t v100;
     uint8_t bin[CONFIG_WRITE_SIZE];
 } config_u;
+_Static_assert(sizeof(config_u) == CONFIG_WRITE_SIZE, "config_t is too large");
 
 config_u __noinit(config);
 gpio_config_t __noinit(gpio_config);
@@ -225,7 +319,13 @@ static bool config_save_slow(void)
 }
 
 
-static bool rom_load(int32_t bank)
+// image the emulator is serving now (swap may have switched it to ram)
+static uint8_t *rom_active(void)
+{
+    return (romemu_selected() == 0) ? rom : ram;
+}
+
+static bool rom_load(uint8_t *dst, int32_t bank)
 {
     int ch = dma_claim_unused_channel(true);
 
@@ -234,7 +334,7 @@ static bool rom_load(int32_t bank)
     channel_config_set_read_increment(&c, true);
     channel_config_set_write_increment(&c, true);
 
-    dma_channel_configure(ch, &c, rom, flash_target_contents_rom[bank], sizeof(rom) / 4, true);
+    dma_channel_configure(ch, &c, dst, flash_target_contents_rom[bank], sizeof(rom) / 4, true);
 
     dma_channel_wait_for_finish_blocking(ch);
 
@@ -243,13 +343,13 @@ static bool rom_load(int32_t bank)
     return true;
 }
 
-static bool rom_load_slow(int32_t bank)
+static bool rom_load_slow(uint8_t *dst, int32_t bank)
 {
     bool ret;
 
     set_sys_clock_khz(CPU_CLOCK_FREQ_NORMAL, true);
     sleep_ms(FLASH_WAIT_MS);
-    ret = rom_load(bank);
+    ret = rom_load(dst, bank);
     sleep_ms(FLASH_WAIT_MS);
     set_sys_clock_khz(CPU_CLOCK_FREQ_HIGH, true);
 
@@ -279,25 +379,25 @@ static bool rom_load_async_wait(int32_t ch)
     return true;
 }
 
-static bool rom_save(int32_t bank)
+static bool rom_save(const uint8_t *src, int32_t bank)
 {
     uint32_t ints = save_and_disable_interrupts();
     multicore_lockout_start_blocking();
     flash_range_erase(FLASH_TARGET_OFFSET_ROM[bank], sizeof(rom));
-    flash_range_program(FLASH_TARGET_OFFSET_ROM[bank], rom, sizeof(rom));
+    flash_range_program(FLASH_TARGET_OFFSET_ROM[bank], src, sizeof(rom));
     multicore_lockout_end_blocking();
     restore_interrupts(ints);
 
-    return memcmp(flash_target_contents_rom[bank], rom, sizeof(rom)) == 0;
+    return memcmp(flash_target_contents_rom[bank], src, sizeof(rom)) == 0;
 }
 
-static bool rom_save_slow(int32_t bank)
+static bool rom_save_slow(const uint8_t *src, int32_t bank)
 {
     bool ret;
 
     set_sys_clock_khz(CPU_CLOCK_FREQ_NORMAL, true);
     sleep_ms(FLASH_WAIT_MS);
-    ret = rom_save(bank);
+    ret = rom_save(src, bank);
     sleep_ms(FLASH_WAIT_MS);
     set_sys_clock_khz(CPU_CLOCK_FREQ_HIGH, true);
 
@@ -349,25 +449,184 @@ static bool rom_erase_slow(int32_t bank)
 }
 
 
-static void capture_target_enable(uint32_t start, uint32_t end)
+typedef enum bitmap_op
+{
+    BITMAP_SET,
+    BITMAP_CLEAR,
+    BITMAP_INVERT,
+} bitmap_op_e;
+
+// apply op to bits start..end, a word at a time
+static void bitmap_update(uint32_t *map, uint32_t start, uint32_t end, bitmap_op_e op)
+{
+    for (uint32_t w = start / 32; w <= end / 32; w++)
+    {
+        uint32_t mask = 0xffffffff;
+        if (w == start / 32)
+        {
+            mask &= 0xffffffff << (start % 32);
+        }
+        if (w == end / 32)
+        {
+            mask &= 0xffffffff >> (31 - end % 32);
+        }
+        switch (op)
+        {
+        case BITMAP_SET:
+            map[w] |= mask;
+            break;
+        case BITMAP_CLEAR:
+            map[w] &= ~mask;
+            break;
+        case BITMAP_INVERT:
+            map[w] ^= mask;
+            break;
+        }
+    }
+}
+
+// first address in addr..end whose bit is value (end + 1: none)
+static uint32_t bitmap_find(const uint32_t *map, uint32_t addr, uint32_t end, bool value)
+{
+    while (addr <= end)
+    {
+        uint32_t w = value ? map[addr / 32] : ~map[addr / 32];
+        w &= 0xffffffff << (addr % 32);
+        if (w != 0)
+        {
+            addr = (addr & ~31) + __builtin_ctz(w);
+            return (addr <= end) ? addr : end + 1;
+        }
+        addr = (addr & ~31) + 32;
+    }
+    return end + 1;
+}
+
+static void capture_target_summarize(uint32_t start, uint32_t end)
 {
-    for (uint32_t addr = start; addr <= end; addr++)
+    for (uint32_t block = start / 1024; block <= end / 1024; block++)
     {
-        capture_target[addr / 8] |= (1 << (addr % 8));
+        const uint64_t mask = (uint64_t)1 << block;
+        capture_target_summary &= ~mask;
+        if (bitmap_find(capture_target, block * 1024, block * 1024 + 1023, true) < block * 1024 + 1024)
+        {
+            capture_target_summary |= mask;
+        }
     }
 }
 
+static void capture_target_update(uint32_t start, uint32_t end, bitmap_op_e op)
+{
+    bitmap_update(capture_target, start, end, op);
+    capture_target_summarize(start, end);
+}
+
+static void capture_target_enable(uint32_t start, uint32_t end)
+{
+    capture_target_update(start, end, BITMAP_SET);
+}
+
 static void capture_target_disable(uint32_t start, uint32_t end)
 {
-    for (uint32_t addr = start; addr <= end; addr++)
+    capture_target_update(start, end, BITMAP_CLEAR);
+}
+
+// as bitmap_find, skipping 1KiB blocks without watched address
+static uint32_t capture_target_find(uint32_t addr, uint32_t end, bool value)
+{
+    if (value)
+    {
+        while ((addr <= end) && ((capture_target_summary & ((uint64_t)1 << (addr / 1024))) == 0))
+        {
+            addr = (addr & ~1023) + 1024;
+        }
+    }
+    return bitmap_find(capture_target, addr, end, value);
+}
+
+static void watch_profile_load(const watch_profile_t *profile)
+{
+    capture_target_update(0x0000, 0xffff, BITMAP_CLEAR);
+    for (uint32_t i = 0; (i < profile->count) && (i < WATCH_RANGE_MAX); i++)
+    {
+        if (profile->range[i][0] <= profile->range[i][1])
+        {
+            capture_target_update(profile->range[i][0], profile->range[i][1], BITMAP_SET);
+        }
+    }
+}
+
+static bool watch_profile_store(watch_profile_t *profile, const char *name)
+{
+    uint32_t count = 0;
+    uint32_t addr = 0x0000;
+
+    while ((addr = capture_target_find(addr, 0xffff, true)) <= 0xffff)
+    {
+        const uint32_t next = capture_target_find(addr, 0xffff, false);
+        if (count >= WATCH_RANGE_MAX)
+        {
+            return false;
+        }
+        profile->range[count][0] = addr;
+        profile->range[count][1] = next - 1;
+        count++;
+        addr = next;
+    }
+    strncpy(profile->name, name, WATCH_NAME_SIZE - 1);
+    profile->name[WATCH_NAME_SIZE - 1] = '\0';
+    profile->count = count;
+    return true;
+}
+
+static int32_t watch_profile_find(const char *name)
+{
+    for (int32_t i = 0; i < WATCH_PROFILE_NUM; i++)
+    {
+        if ((config.cfg.watch[i].name[0] != '\0') && (strncmp(config.cfg.watch[i].name, name, WATCH_NAME_SIZE - 1) == 0))
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool config_watch_truncated = false;  // reported when connected
+
+// VER1.00 config: keep its fields, defaults for the new ones, bitmap to profile "default"
+static bool config_migrate(void)
+{
+    if (memcmp(config.v100.magic, MAGIC_STR_V100, MAGIC_SIZE) != 0)
+    {
+        return false;
+    }
+    const config_mode_e mode = config.v100.mode;
+    const int32_t rom_bank = config.v100.rom_bank;
+    const int32_t dump_line_count = config.v100.dump_line_count;
+    const gpio_config_t gpio = config.v100.gpio_config;
+    memcpy(capture_target, config.v100.capture_target, sizeof(capture_target));
+
+    config_init();
+    config.cfg.mode = mode;
+    config.cfg.rom_bank = rom_bank;
+    config.cfg.dump_line_count = dump_line_count;
+    config.cfg.gpio_config = gpio;
+
+    capture_target_summarize(0x0000, 0xffff);
+    if (!watch_profile_store(&config.cfg.watch[0], "default"))
     {
-        capture_target[addr / 8] &= ~(1 << (addr % 8));
+        // too fragmented: keep as many ranges as possible
+        config.cfg.watch[0].count = WATCH_RANGE_MAX;
+        strcpy(config.cfg.watch[0].name, "default");
+        config_watch_truncated = true;
     }
+    config.cfg.watch_profile = 0;
+    return true;
 }
 
 static inline bool capture_is_target(uint32_t addr)
 {
-    return (capture_target[addr / 8] & (1 << (addr % 8))) != 0;
+    return (capture_target[addr / 32] & bit(addr % 32)) != 0;
 }
 
 
@@ -388,6 +647,36 @@ static void zero_clear(uint8_t *p, int32_t size)
     dma_channel_unclaim(ch);
 }
 
+static uint32_t dma_sniff(const uint8_t *src, uint32_t size, uint calc, uint32_t seed, bool out_rev_inv)
+{
+    static uint32_t sink;
+    int ch = dma_claim_unused_channel(true);
+
+    dma_channel_config c = dma_channel_get_default_config(ch);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_sniff_enable(&c, true);
+
+    dma_sniffer_enable(ch, calc, true);
+    dma_sniffer_set_output_reverse_enabled(out_rev_inv);
+    dma_sniffer_set_output_invert_enabled(out_rev_inv);
+    dma_sniffer_set_data_accumulator(seed);
+
+    dma_channel_configure(ch, &c, &sink, src, size, true);
+
+    dma_channel_wait_for_finish_blocking(ch);
+
+    uint32_t ret = dma_sniffer_get_data_accumulator();
+    dma_sniffer_disable();
+    dma_sniffer_set_output_reverse_enabled(false);
+    dma_sniffer_set_output_invert_enabled(false);
+
+    dma_channel_unclaim(ch);
+
+    return ret;
+}
+
 static void reboot(uint32_t delay_ms)
 {
     printf("rebooting...\n\n");
@@ -401,113 +690,708 @@ static void reboot(uint32_t delay_ms)
     }
 }
 
-static void read_rom(uint8_t *dst, uint32_t start, uint32_t end)
+static void read_rom(uint8_t *dst, uint32_t start, uint32_t end, uint32_t delay)
 {
     gpio_put_all(bit(GPIO_CE) | bit(GPIO_OE));
     sleep_us(1);
-    for (uint32_t addr = start; addr < end; addr++)
+    gpio_put_all(bit(GPIO_OE));
+    romread_read(dst, start, end, delay);
+    gpio_put_all(bit(GPIO_CE) | bit(GPIO_OE));
+}
+
+// flash rom command set emulation (runs on core1, applied to the live rom image)
+typedef enum flash_emu_type
+{
+    FLASH_EMU_OFF = 0,
+    FLASH_EMU_29F,
+    FLASH_EMU_AT29,
+    FLASH_EMU_28C,
+    FLASH_EMU_NUM
+} flash_emu_type_e;
+
+static const struct
+{
+    const char *name;
+    uint8_t maker_id;
+    uint8_t device_id;
+    uint32_t unit_size;     // sector (29F) / page (AT29, 28C)
+} flash_emu_table[FLASH_EMU_NUM] =
+{
+    {"off",     0x00, 0x00, 0},
+    {"29f",     0xbf, 0xb4, 0x1000},    // SST39SF512
+    {"at29",    0x1f, 0x5d, 0x80},      // AT29C512
+    {"28c",     0x00, 0x00, 0x40},      // 28C64/28C256 (no SDP)
+};
+
+typedef enum flash_emu_state
+{
+    FLASH_STATE_READ = 0,
+    FLASH_STATE_UNLOCK1,
+    FLASH_STATE_UNLOCK2,
+    FLASH_STATE_PROGRAM,
+    FLASH_STATE_PAGE_START,
+    FLASH_STATE_PAGE,
+    FLASH_STATE_ERASE,
+    FLASH_STATE_ERASE_UNLOCK1,
+    FLASH_STATE_ERASE_UNLOCK2,
+} flash_emu_state_e;
+
+#define FLASH_EMU_PAGE_TIMEOUT_US   150     // AT29 byte load cycle time (tBLC)
+
+static volatile flash_emu_type_e flash_emu_type = FLASH_EMU_OFF;
+static flash_emu_state_e flash_emu_state = FLASH_STATE_READ;
+static uint32_t flash_emu_page = 0;
+static uint32_t flash_emu_page_time = 0;
+static bool flash_emu_autoselect_on = false;
+static uint8_t flash_emu_autoselect_save[2];
+static volatile bool flash_emu_dirty = false;
+static volatile uint32_t flash_emu_program_count = 0;
+static volatile uint32_t flash_emu_erase_count = 0;
+
+// manufacturer/device id are served from rom[0], rom[1] while in autoselect
+// (core0 changes it only while core1 is locked out)
+static void flash_emu_autoselect(bool on)
+{
+    if (on && !flash_emu_autoselect_on)
     {
-        gpio_put_all(addr | bit(GPIO_OE));
-        sleep_us(1);
-        gpio_put_all(addr);
-        sleep_us(1);
-        dst[addr] = GPIO_GET_DATA(gpio_get_all());
+        flash_emu_autoselect_save[0] = rom[0];
+        flash_emu_autoselect_save[1] = rom[1];
+        rom[0] = flash_emu_table[flash_emu_type].maker_id;
+        rom[1] = flash_emu_table[flash_emu_type].device_id;
     }
-    gpio_put_all(bit(GPIO_CE) | bit(GPIO_OE));
+    else if (!on && flash_emu_autoselect_on)
+    {
+        rom[0] = flash_emu_autoselect_save[0];
+        rom[1] = flash_emu_autoselect_save[1];
+    }
+    flash_emu_autoselect_on = on;
 }
 
+// the erase is done at the command in one pass (a chip erase takes tens of us,
+// the capture ring may lap meanwhile: it shows up as a lost record)
+static void flash_emu_erase(uint32_t addr, uint32_t size)
+{
+    flash_emu_autoselect(false);
+    memset(&rom[addr & ~(size - 1)], 0xff, size);
+    flash_emu_dirty = true;
+    flash_emu_erase_count++;
+}
 
-static void core1_entry_emulator(void)
+// no status is served: the image is read by PIO directly, so DQ7 polling and
+// DQ6 toggle see the data as soon as core1 has applied the command (it lags the
+// bus by the capture latency, during which the old data is read)
+static void flash_emu_write(uint32_t addr, uint8_t data)
 {
-    uint32_t cap;
-    uint32_t rw = 3;
-    uint32_t rw_prev;
-    uint32_t addr;
+    const flash_emu_type_e type = flash_emu_type;
+    const uint32_t unit_size = flash_emu_table[type].unit_size;
+    const uint32_t cmd_addr = addr & 0x7ff; // 0x5555/0x2aaa or 0x555/0x2aa
+    const uint32_t now = time_us_32();
 
-    multicore_lockout_victim_init();
+    if (type == FLASH_EMU_28C)
+    {
+        rom[addr] = data;
+        flash_emu_dirty = true;
+        flash_emu_program_count++;
+        return;
+    }
 
-    busmon_cap_start();
-    while (true)
+    if (flash_emu_state == FLASH_STATE_PAGE)
     {
-        if (!busmon_cap_is_empty())
+        // AT29: page load continues while writes stay in the same page within tBLC
+        // (time of processing on core1, not of the bus cycle)
+        if (((addr & ~(unit_size - 1)) == flash_emu_page) && (now - flash_emu_page_time < FLASH_EMU_PAGE_TIMEOUT_US))
         {
-            cap = busmon_cap_pop();
-            addr = cap & 0x00ffff;
-            if (capture_is_target(addr))
+            rom[addr] = data;
+            flash_emu_page_time = now;
+            return;
+        }
+        flash_emu_state = FLASH_STATE_READ;
+    }
+
+    switch (flash_emu_state)
+    {
+    case FLASH_STATE_READ:
+        if ((cmd_addr == 0x555) && (data == 0xaa))
+        {
+            flash_emu_state = FLASH_STATE_UNLOCK1;
+        }
+        else if (data == 0xf0)
+        {
+            flash_emu_autoselect(false);
+        }
+        break;
+    case FLASH_STATE_UNLOCK1:
+        flash_emu_state = ((cmd_addr == 0x2aa) && (data == 0x55)) ? FLASH_STATE_UNLOCK2 : FLASH_STATE_READ;
+        break;
+    case FLASH_STATE_UNLOCK2:
+        flash_emu_state = FLASH_STATE_READ;
+        if (cmd_addr == 0x555)
+        {
+            switch (data)
             {
-                capture_buffer[capture_wp] = cap;
-                capture_wp = (capture_wp + 1) % CAPTURE_COUNT;
+            case 0xa0:
+                flash_emu_state = (type == FLASH_EMU_AT29) ? FLASH_STATE_PAGE_START : FLASH_STATE_PROGRAM;
+                break;
+            case 0x80:
+                flash_emu_state = FLASH_STATE_ERASE;
+                break;
+            case 0x90:
+                flash_emu_autoselect(true);
+                break;
+            case 0xf0:
+                flash_emu_autoselect(false);
+                break;
             }
         }
-        tight_loop_contents();
+        break;
+    case FLASH_STATE_PROGRAM:
+        // programming can only clear bits
+        rom[addr] &= data;
+        flash_emu_dirty = true;
+        flash_emu_program_count++;
+        flash_emu_state = FLASH_STATE_READ;
+        break;
+    case FLASH_STATE_PAGE_START:
+        // AT29: the page is erased and reprogrammed with the loaded bytes
+        flash_emu_page = addr & ~(unit_size - 1);
+        memset(&rom[flash_emu_page], 0xff, unit_size);
+        rom[addr] = data;
+        flash_emu_page_time = now;
+        flash_emu_dirty = true;
+        flash_emu_program_count++;
+        flash_emu_state = FLASH_STATE_PAGE;
+        break;
+    case FLASH_STATE_ERASE:
+        flash_emu_state = ((cmd_addr == 0x555) && (data == 0xaa)) ? FLASH_STATE_ERASE_UNLOCK1 : FLASH_STATE_READ;
+        break;
+    case FLASH_STATE_ERASE_UNLOCK1:
+        flash_emu_state = ((cmd_addr == 0x2aa) && (data == 0x55)) ? FLASH_STATE_ERASE_UNLOCK2 : FLASH_STATE_READ;
+        break;
+    case FLASH_STATE_ERASE_UNLOCK2:
+        flash_emu_state = FLASH_STATE_READ;
+        if ((cmd_addr == 0x555) && (data == 0x10))
+        {
+            flash_emu_erase(0x0000, sizeof(rom));
+        }
+        else if ((data == 0x30) && (type == FLASH_EMU_29F))
+        {
+            flash_emu_erase(addr, unit_size);
+        }
+        break;
+    default:
+        flash_emu_state = FLASH_STATE_READ;
+        break;
     }
 }
 
-static void core1_entry_clone(void)
+// save the live image without the id overlay and the pending erase (core1 is parked)
+static bool flash_emu_save_slow(int32_t bank)
 {
-    multicore_lockout_victim_init();
+    bool ret;
 
-    while (true)
+    set_sys_clock_khz(CPU_CLOCK_FREQ_NORMAL, true);
+    sleep_ms(FLASH_WAIT_MS);
+    uint32_t ints = save_and_disable_interrupts();
+    multicore_lockout_start_blocking();
+    const bool id = flash_emu_autoselect_on;
+    flash_emu_autoselect(false);
+    flash_range_erase(FLASH_TARGET_OFFSET_ROM[bank], sizeof(rom));
+    flash_range_program(FLASH_TARGET_OFFSET_ROM[bank], rom, sizeof(rom));
+    ret = memcmp(flash_target_contents_rom[bank], rom, sizeof(rom)) == 0;
+    flash_emu_autoselect(id);
+    flash_emu_dirty = false;
+    multicore_lockout_end_blocking();
+    restore_interrupts(ints);
+    sleep_ms(FLASH_WAIT_MS);
+    set_sys_clock_khz(CPU_CLOCK_FREQ_HIGH, true);
+
+    return ret;
+}
+
+// trigger engine (runs on core1): condition = (record & mask) == match
+#define TRIG_RW_SHIFT (28)
+typedef struct
+{
+    bool enable;
+    uint32_t mask;
+    uint32_t match;
+} trig_cond_t;
+
+typedef enum trig_state
+{
+    TRIG_STATE_IDLE = 0,
+    TRIG_STATE_ARMED,
+    TRIG_STATE_WAIT_B,      // A matched, waiting for B
+    TRIG_STATE_FIRED,       // storing post-trigger events
+    TRIG_STATE_DONE,        // buffer frozen
+} trig_state_e;
+
+static trig_cond_t trig_cond[2];            // A, B
+static uint32_t trig_within = 0;            // B must follow A within N events
+static uint32_t trig_count = 1;             // fire on the N-th occurrence
+static uint32_t trig_pre = 16;
+static uint32_t trig_post = 16;
+static volatile trig_state_e trig_state = TRIG_STATE_IDLE;
+static uint32_t trig_occurrence;
+static uint32_t trig_window;
+static uint32_t trig_post_left;
+static volatile uint32_t trig_pos;          // capture_wp of the trigger event
+static bool trig_pos_stored;
+
+static inline void capture_store(uint32_t cap, uint32_t ts)
+{
+    work_area.capture_buffer[capture_wp % CAPTURE_COUNT] = cap;
+    if (capture_record_words > 1)
     {
-        sleep_ms(1000);
-        tight_loop_contents();
+        work_area.capture_buffer[(capture_wp + 1) % CAPTURE_COUNT] = ts;
     }
+    capture_wp += capture_record_words;
 }
 
+static uint32_t rle_next = 0x10000;     // address continuing the run (none)
+static uint32_t rle_ctrl;
+static uint32_t rle_start;              // first address of the pending run
+static uint32_t rle_len;                // pending reads of the run
+static uint32_t rle_ts;                 // timestamp of the last read of the run
+static uint32_t rle_time;
 
-static void memdump(const uint8_t *mem, uint32_t addr, int32_t count)
+static inline void rle_flush(void)
 {
-    for (int y = 0; y < count; y++)
+    if (rle_len != 0)
     {
-        printf("%04x ", addr & 0xffff);
-        for (int x = 0; x < 16; x++)
+        capture_store(CAPTURE_RUN | (2 << 28) | rle_ctrl | (rle_len << CAPTURE_RUN_LEN_SHIFT) | rle_start, rle_ts);
+        rle_len = 0;
+    }
+}
+
+static inline void rle_store(uint32_t cap, uint32_t ts)
+{
+    const uint32_t addr = cap & 0xffff;
+
+    if (((cap >> 28) == 2) && (addr == rle_next) && ((cap & CAPTURE_CTRL) == rle_ctrl))
+    {
+        if (rle_len == 0)
         {
-            printf(" %02x", mem[(addr + x) & 0xffff]);
+            rle_start = addr;
         }
-        printf("  ");
-        for (int x = 0; x < 16; x++)
+        rle_len++;
+        rle_ts = ts;
+        rle_time = time_us_32();
+        rle_next = (addr + 1) & 0xffff;
+        if (rle_len == (CAPTURE_RUN_LEN >> CAPTURE_RUN_LEN_SHIFT))
         {
-            int c = mem[(addr + x) & 0xffff];
-            printf("%c", isprint(c) ? c : '.');
+            rle_flush();
         }
-        printf("\n");
-        addr += 16;
+        return;
     }
+    rle_flush();
+    capture_store(cap, ts);
+    rle_next = ((cap >> 28) == 2) ? (addr + 1) & 0xffff : 0x10000;
+    rle_ctrl = cap & CAPTURE_CTRL;
 }
 
-static void dump_diff(const uint8_t *mem0, const uint8_t *mem1, int32_t count, int32_t max_diff_count)
+static inline bool trig_match(const trig_cond_t *cond, uint32_t cap)
 {
-    int32_t diff_count = 0;
-    for (int32_t idx = 0; idx < count; idx++)
+    return (cap & cond->mask) == cond->match;
+}
+
+// called for each access before it is stored (stored: it goes into capture_buffer)
+static void trig_event(uint32_t cap, bool stored)
+{
+    bool hit = false;
+
+    switch (trig_state)
     {
-        if (mem0[idx] != mem1[idx])
+    case TRIG_STATE_ARMED:
+        if (trig_match(&trig_cond[0], cap))
         {
-            diff_count++;
-            if (diff_count <= max_diff_count)
+            if (trig_cond[1].enable)
             {
-                printf("  %04x: %02x %02x\n", idx, mem0[idx], mem1[idx]);
+                trig_state = TRIG_STATE_WAIT_B;
+                trig_window = trig_within;
             }
+            else
+            {
+                hit = true;
+            }
+        }
+        break;
+    case TRIG_STATE_WAIT_B:
+        if (trig_match(&trig_cond[1], cap))
+        {
+            hit = true;
+        }
+        else if ((trig_within != 0) && (--trig_window == 0))
+        {
+            trig_state = TRIG_STATE_ARMED;
         }
+        break;
+    case TRIG_STATE_FIRED:
+        if (stored && (--trig_post_left == 0))
+        {
+            trig_state = TRIG_STATE_DONE;
+        }
+        break;
+    default:
+        break;
     }
-    printf(" %d missmatch(es)\n", diff_count);
-}
 
-static void cmd_hello(int argc, const char *const *argv)
-{
-    printf("hello world\n");
-    for (int i = 0; i < argc; i++)
+    if (hit)
     {
-        printf("%d: %s\n", i, argv[i]);
+        trig_state = TRIG_STATE_ARMED;
+        if (++trig_occurrence >= trig_count)
+        {
+            // the trigger event is stored at trig_pos (if it is watched),
+            // not folded into a run
+            rle_flush();
+            rle_next = 0x10000;
+            trig_pos = capture_wp;
+            trig_pos_stored = stored;
+            trig_post_left = trig_post;
+            trig_state = (trig_post_left == 0) ? TRIG_STATE_DONE : TRIG_STATE_FIRED;
+        }
     }
 }
 
-static void cmd_cls(int argc, const char *const *argv)
+static uint32_t capture_ring_dropped = 0;
+static uint32_t capture_ring_stall = 0;
+
+// store a lost record where the DMA ring or the PIO lost events
+static inline void capture_check_lost(uint32_t ts)
 {
-    printf("\x1b[2J");
-}
+    uint32_t dropped;
+    uint32_t stall;
 
+    busmon_cap_get_lost(&dropped, &stall);
+    if ((dropped == capture_ring_dropped) && (stall == capture_ring_stall))
+    {
+        return;
+    }
+    const uint32_t n = dropped - capture_ring_dropped;
+    rle_flush();
+    capture_store(CAPTURE_LOST | ((stall != capture_ring_stall) ? CAPTURE_LOST_STALL : 0) |
+                  ((n < CAPTURE_LOST_COUNT) ? n : CAPTURE_LOST_COUNT), ts);
+    rle_next = 0x10000;
+    capture_ring_dropped = dropped;
+    capture_ring_stall = stall;
+}
 
-static void cmd_reboot(int argc, const char *const *argv)
+static inline void cov_event(uint32_t cap)
+{
+    const uint32_t addr = cap & 0xffff;
+
+    if ((cap >> 28) == 2)
+    {
+        uint16_t *count = &work_area.cov.count[addr / COV_BLOCK_SIZE];
+        work_area.cov.read[addr / 32] |= bit(addr % 32);
+        if (*count != 0xffff)
+        {
+            (*count)++;
+        }
+    }
+    else if ((cap >> 28) == 1)
+    {
+        work_area.cov.write[addr / 32] |= bit(addr % 32);
+    }
+}
+
+// sampling profiler of read addresses
+#define PROF_BINS 256
+#define PROF_SYM_MAX 16
+#define PROF_SYM_NAME_SIZE 12
+
+typedef struct
+{
+    uint32_t start;
+    uint32_t end;
+    char name[PROF_SYM_NAME_SIZE];
+} prof_sym_t;
+
+static volatile bool prof_enable = false;
+static bool prof_by_time = true;        // true: every interval us, false: every interval reads
+static uint32_t prof_interval = 10;
+static uint32_t prof_shift = 8;         // bin size 256
+static uint32_t prof_base = 0;
+static prof_sym_t prof_sym[PROF_SYM_MAX];
+static uint32_t prof_sym_num = 0;       // 0: bins, otherwise: symbols
+static uint32_t prof_bin[PROF_BINS];    // bins or symbols
+static uint32_t prof_other;             // outside of bins/symbols
+static uint32_t prof_samples;
+static uint32_t prof_skip;
+static uint32_t prof_last;
+
+static inline void prof_event(uint32_t addr)
+{
+    if (prof_by_time)
+    {
+        const uint32_t now = time_us_32();
+        if (now - prof_last < prof_interval)
+        {
+            return;
+        }
+        prof_last = now;
+    }
+    else if (++prof_skip < prof_interval)
+    {
+        return;
+    }
+    prof_skip = 0;
+    prof_samples++;
+
+    if (prof_sym_num != 0)
+    {
+        for (uint32_t i = 0; i < prof_sym_num; i++)
+        {
+            if ((addr >= prof_sym[i].start) && (addr <= prof_sym[i].end))
+            {
+                prof_bin[i]++;
+                return;
+            }
+        }
+        prof_other++;
+        return;
+    }
+    const uint32_t offset = addr - prof_base;
+    if (offset < (PROF_BINS << prof_shift))
+    {
+        prof_bin[offset >> prof_shift]++;
+    }
+    else
+    {
+        prof_other++;
+    }
+}
+
+// control-flow edges and basic blocks of read addresses
+#define EDGE_TABLE_BITS 8
+#define EDGE_TABLE_SIZE (1 << EDGE_TABLE_BITS)
+#define EDGE_BLOCK_BITS 7
+#define EDGE_BLOCK_SIZE (1 << EDGE_BLOCK_BITS)
+#define EDGE_PROBE_MAX 8
+#define EDGE_SHOW_MAX 32
+
+typedef struct
+{
+    uint32_t key;           // from << 16 | to
+    uint32_t count;
+    bool used;
+} edge_entry_t;
+
+static volatile bool edge_enable = false;
+static edge_entry_t edge_table[EDGE_TABLE_SIZE];    // (from, to)
+static edge_entry_t edge_block[EDGE_BLOCK_SIZE];    // (start, end)
+static uint32_t edge_last = 0x10000;                // last read (0x10000: none)
+static uint32_t edge_start;                         // start of the current block
+static uint32_t edge_reads;
+static uint32_t edge_count;
+static uint32_t edge_dropped;                       // entries replaced (tables were full)
+
+// false: the least hit entry of the probe window was replaced (space-saving:
+// the new entry takes over its count, so the count is an upper bound)
+static inline bool edge_hit(edge_entry_t *table, uint32_t bits, uint32_t key)
+{
+    const uint32_t mask = (1 << bits) - 1;
+    uint32_t i = (key * 2654435761u) >> (32 - bits);
+    edge_entry_t *min = &table[i];
+
+    for (uint32_t n = 0; n < EDGE_PROBE_MAX; n++, i = (i + 1) & mask)
+    {
+        if (!table[i].used)
+        {
+            table[i].key = key;
+            table[i].count = 1;
+            table[i].used = true;
+            return true;
+        }
+        if (table[i].key == key)
+        {
+            table[i].count++;
+            return true;
+        }
+        if (table[i].count < min->count)
+        {
+            min = &table[i];
+        }
+    }
+    min->key = key;
+    min->count++;
+    return false;
+}
+
+static inline void edge_event(uint32_t addr)
+{
+    const uint32_t last = edge_last;
+
+    edge_reads++;
+    edge_last = addr;
+    if ((addr == last) || (addr == last + 1))
+    {
+        // sequential fetch or repeated (dummy) read
+        return;
+    }
+    if (last <= 0xffff)
+    {
+        edge_count++;
+        if (!edge_hit(edge_table, EDGE_TABLE_BITS, (last << 16) | addr))
+        {
+            edge_dropped++;
+        }
+        if (!edge_hit(edge_block, EDGE_BLOCK_BITS, (edge_start << 16) | last))
+        {
+            edge_dropped++;
+        }
+    }
+    edge_start = addr;
+}
+
+static void core1_entry_emulator(void)
+{
+    uint32_t cap;
+    uint32_t ts;
+    uint32_t rw = 3;
+    uint32_t rw_prev;
+    uint32_t addr;
+
+    multicore_lockout_victim_init();
+
+    busmon_cap_start();
+    while (true)
+    {
+        if (capture_deep && (flash_emu_type == FLASH_EMU_OFF))
+        {
+            busmon_cap_start();
+        }
+        else if (!busmon_cap_is_empty())
+        {
+            cap = busmon_cap_pop();
+            ts = (capture_record_words > 1) ? busmon_cap_pop() : 0;
+            addr = cap & 0x00ffff;
+            // write cycle with /CE == 0
+            if ((flash_emu_type != FLASH_EMU_OFF) && ((cap >> 28) == 1) && ((cap & bit(GPIO_CE)) == 0))
+            {
+                flash_emu_write(addr, (cap >> 16) & 0xff);
+            }
+            // capfilt moved out of PIO to keep the flash commands visible
+            if ((addr & capture_filter_mask) != capture_filter_block)
+            {
+                continue;
+            }
+            if (prof_enable && ((cap >> 28) == 2))
+            {
+                prof_event(addr);
+            }
+            // reads of this ROM only
+            if (edge_enable && ((cap >> 28) == 2) && ((cap & bit(GPIO_CE)) == 0))
+            {
+                edge_event(addr);
+            }
+            if (capture_cov)
+            {
+                // all addresses, watch is not used
+                cov_event(cap);
+                continue;
+            }
+            if (!capture_deep && (trig_state != TRIG_STATE_DONE))
+            {
+                capture_check_lost(ts);
+            }
+            // deep capture: DMA already wrote it into capture_buffer
+            const bool stored = !capture_deep && capture_is_target(addr) && (trig_state != TRIG_STATE_DONE);
+            if (trig_state != TRIG_STATE_IDLE)
+            {
+                trig_event(cap, stored);
+            }
+            if (stored)
+            {
+                if (capture_rle)
+                {
+                    rle_store(cap, ts);
+                    if (trig_state == TRIG_STATE_DONE)
+                    {
+                        // buffer frozen: store the post-trigger tail
+                        rle_flush();
+                    }
+                }
+                else
+                {
+                    capture_store(cap, ts);
+                }
+            }
+        }
+        else if ((rle_len != 0) && (time_us_32() - rle_time > CAPTURE_RUN_FLUSH_US))
+        {
+            // bus is idle: make the run visible to the reader
+            rle_flush();
+        }
+        tight_loop_contents();
+    }
+}
+
+static void core1_entry_clone(void)
+{
+    multicore_lockout_victim_init();
+
+    while (true)
+    {
+        sleep_ms(1000);
+        tight_loop_contents();
+    }
+}
+
+
+static void memdump(const uint8_t *mem, uint32_t addr, int32_t count)
+{
+    for (int y = 0; y < count; y++)
+    {
+        printf("%04x ", addr & 0xffff);
+        for (int x = 0; x < 16; x++)
+        {
+            printf(" %02x", mem[(addr + x) & 0xffff]);
+        }
+        printf("  ");
+        for (int x = 0; x < 16; x++)
+        {
+            int c = mem[(addr + x) & 0xffff];
+            printf("%c", isprint(c) ? c : '.');
+        }
+        printf("\n");
+        addr += 16;
+    }
+}
+
+static void dump_diff(const uint8_t *mem0, const uint8_t *mem1, int32_t count, int32_t max_diff_count)
+{
+    int32_t diff_count = 0;
+    for (int32_t idx = 0; idx < count; idx++)
+    {
+        if (mem0[idx] != mem1[idx])
+        {
+            diff_count++;
+            if (diff_count <= max_diff_count)
+            {
+                printf("  %04x: %02x %02x\n", idx, mem0[idx], mem1[idx]);
+            }
+        }
+    }
+    printf(" %d missmatch(es)\n", diff_count);
+}
+
+static void cmd_hello(int argc, const char *const *argv)
+{
+    printf("hello world\n");
+    for (int i = 0; i < argc; i++)
+    {
+        printf("%d: %s\n", i, argv[i]);
+    }
+}
+
+static void cmd_cls(int argc, const char *const *argv)
+{
+    printf("\x1b[2J");
+}
+
+
+static void cmd_reboot(int argc, const char *const *argv)
 {
     uint32_t delay_ms = REBOOT_DELAY_MS;
     if (argc > 0)
@@ -545,12 +1429,20 @@ static void cmd_mode(int argc, const char *const *argv)
             reboot(REBOOT_DELAY_MS);
             return;
         }
+        else if (strcmp(argv[1], "sram") == 0)
+        {
+            config.cfg.mode = CONFIG_MODE_SRAM;
+            printf("mode: sram\n");
+            config_save_slow();
+            reboot(REBOOT_DELAY_MS);
+            return;
+        }
         else
         {
             printf("error: unknown mode.\n");
         }
     }
-    printf("mode emulator|snoop|clone\n");
+    printf("mode emulator|snoop|clone|sram\n");
     switch (config.cfg.mode)
     {
     case CONFIG_MODE_EMULATOR:
@@ -562,96 +1454,347 @@ static void cmd_mode(int argc, const char *const *argv)
     case CONFIG_MODE_CLONE:
         printf("current mode: clone\n");
         break;
+    case CONFIG_MODE_SRAM:
+        printf("current mode: sram\n");
+        break;
     default:
         printf("current mode: unknown (%d)\n", config.cfg.mode);
         break;
     }
 }
 
-static void cmd_bootsel(int argc, const char *const *argv)
-{
-    if (argc > 0)
-    {
-        uint32_t delay_ms = REBOOT_DELAY_MS;
-        delay_ms = strtol(argv[1], NULL, 10);
-        sleep_ms(delay_ms);
-    }
-    reset_usb_boot(0, 0);
-}
-
-static struct
-{
-    const char* name;
-    uint32_t pin;
-} gpio_pin_name_table[] =
+static void cmd_capture_stat(int argc, const char *const *argv)
 {
-    {"a0",          GPIO_ADDR + 0},
-    {"a1",          GPIO_ADDR + 1},
-    {"a2",          GPIO_ADDR + 2},
-    {"a3",          GPIO_ADDR + 3},
-    {"a4",          GPIO_ADDR + 4},
-    {"a5",          GPIO_ADDR + 5},
-    {"a6",          GPIO_ADDR + 6},
-    {"a7",          GPIO_ADDR + 7},
-    {"a8",          GPIO_ADDR + 8},
-    {"a9",          GPIO_ADDR + 9},
-    {"a10",         GPIO_ADDR + 10},
-    {"a11",         GPIO_ADDR + 11},
-    {"a12",         GPIO_ADDR + 12},
-    {"a13",         GPIO_ADDR + 13},
-    {"a14",         GPIO_ADDR + 14},
-    {"a15",         GPIO_ADDR + 15},
-    {"d0",          GPIO_DATA + 0},
-    {"d1",          GPIO_DATA + 1},
-    {"d2",          GPIO_DATA + 2},
-    {"d3",          GPIO_DATA + 3},
-    {"d4",          GPIO_DATA + 4},
-    {"d5",          GPIO_DATA + 5},
-    {"d6",          GPIO_DATA + 6},
-    {"d7",          GPIO_DATA + 7},
-    {"ce",          GPIO_CE},
-    {"oe",          GPIO_OE},
-    {"wr",          GPIO_WR},
-    {"ext0",        GPIO_EXT0},
-    {"ext1",        GPIO_EXT1},
-    {"ext2",        GPIO_EXT2},
-    {NULL,          0}
-};
+    busmon_cap_stat_t stat;
 
-static uint32_t get_gpio_pin(const char *s)
-{
-    for (int32_t idx = 0; gpio_pin_name_table[idx].name != NULL; idx++)
-    {
-        if (strcmp(s, gpio_pin_name_table[idx].name) == 0)
-        {
-            return gpio_pin_name_table[idx].pin;
-        }
-    }
+    busmon_cap_get_stat(&stat);
+    printf("dma buffer : %d records, written %u, overflow %d, dropped %d records, pio stall %d times\n",
+           stat.count / capture_record_words, stat.written / capture_record_words, stat.overflow, stat.dropped, stat.stall);
+    if (!capture_deep)
     {
-        uint32_t pin;
-        char *end;
-        pin = strtol(s, &end, 10);
-        if (*end == '\0')
-        {
-            return pin;
-        }
+        printf("capture    : %d records, written %u\n", CAPTURE_COUNT / capture_record_words, capture_wp / capture_record_words);
     }
-    return UINT32_MAX;
+    printf("cap        : lost %d records\n", capture_lost);
 }
 
-static void cmd_gpio(int argc, const char *const *argv)
+static void cmd_capture_mode(int argc, const char *const *argv)
 {
     if (argc > 1)
     {
-        uint32_t pin = UINT32_MAX;
-        if (argc == 3 && strcmp(argv[1], "in") == 0)
+        bool ts = false;
+        bool rle = false;
+        const bool cov = (strcmp(argv[1], "cov") == 0);
+        bool ok = (strcmp(argv[1], "normal") == 0) || (strcmp(argv[1], "deep") == 0) || cov;
+
+        for (int32_t i = 2; i < argc; i++)
         {
-            pin = get_gpio_pin(argv[2]);
-            if ((1 << pin) & GPIO_EXT_MASK)
+            if (strcmp(argv[i], "ts") == 0)
             {
-                gpio_config.dir &= ~(1 << pin) & GPIO_EXT_MASK;
-                gpio_set_dir_in_masked(~gpio_config.dir & GPIO_EXT_MASK);
-                return;
+                ts = true;
+            }
+            else if (strcmp(argv[i], "rle") == 0)
+            {
+                rle = true;
+            }
+            else
+            {
+                ok = false;
+            }
+        }
+        if (ok && rle && (strcmp(argv[1], "deep") == 0))
+        {
+            // DMA writes the deep buffer without core1
+            printf("error: rle is only available in capmode normal.\n");
+        }
+        else if (ok && cov && (argc > 2))
+        {
+            printf("error: cov takes no options.\n");
+        }
+        else if (ok)
+        {
+            config.cfg.capture_deep = (strcmp(argv[1], "deep") == 0);
+            config.cfg.capture_ts = ts;
+            config.cfg.capture_rle = rle;
+            config.cfg.capture_cov = cov;
+            printf("capmode: %s%s%s\n", argv[1], ts ? " ts" : "", rle ? " rle" : "");
+            config_save_slow();
+            reboot(REBOOT_DELAY_MS);
+            return;
+        }
+        else
+        {
+            printf("error: unknown capture mode.\n");
+        }
+    }
+    printf("capmode normal|deep [ts] [rle]\n");
+    printf("capmode cov\n");
+    printf("current capmode: %s%s%s\n", capture_cov ? "cov" : capture_deep ? "deep" : "normal",
+           (capture_record_words > 1) ? " ts" : "", capture_rle ? " rle" : "");
+}
+
+static void cmd_capture_filter(int argc, const char *const *argv)
+{
+    if ((argc == 2) && (strcmp(argv[1], "off") == 0))
+    {
+        config.cfg.capture_filter_size = 0;
+        printf("capfilt: off\n");
+        config_save_slow();
+        reboot(REBOOT_DELAY_MS);
+        return;
+    }
+    if (argc == 3)
+    {
+        uint32_t start = strtol(argv[1], NULL, 16);
+        uint32_t end = strtol(argv[2], NULL, 16);
+        uint32_t size = end - start + 1;
+        // the block is compared in PIO: aligned power of two only
+        if ((start <= end) && (end <= 0xffff) && (size <= 0x8000) && ((size & (size - 1)) == 0) && ((start & (size - 1)) == 0))
+        {
+            config.cfg.capture_filter_start = start;
+            config.cfg.capture_filter_size = size;
+            printf("capfilt: %04x-%04x\n", start, end);
+            config_save_slow();
+            reboot(REBOOT_DELAY_MS);
+            return;
+        }
+        printf("error: range must be an aligned power of two block (e.g. c000 c0ff)\n");
+    }
+    printf("capfilt off|start end\n");
+    if (config.cfg.capture_filter_size == 0)
+    {
+        printf("current capfilt: off\n");
+    }
+    else
+    {
+        printf("current capfilt: %04x-%04x\n",
+               config.cfg.capture_filter_start, config.cfg.capture_filter_start + config.cfg.capture_filter_size - 1);
+    }
+}
+
+static void cmd_fcmd(int argc, const char *const *argv)
+{
+    if (config.cfg.mode != CONFIG_MODE_EMULATOR)
+    {
+        printf("error: only available in emulator mode\n");
+        return;
+    }
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "save") == 0)
+        {
+            int32_t bank = config.cfg.rom_bank;
+            bool ret;
+
+            printf("save rom bank %d ... ", bank);
+            ret = flash_emu_save_slow(bank);
+            printf("done.\n");
+            printf("save: %s\n", ret ? "OK" : "NG");
+            return;
+        }
+        for (int32_t i = 0; i < FLASH_EMU_NUM; i++)
+        {
+            if (strcmp(argv[1], flash_emu_table[i].name) == 0)
+            {
+                multicore_lockout_start_blocking();
+                            flash_emu_state = FLASH_STATE_READ;
+                flash_emu_autoselect(false);
+                flash_emu_type = (flash_emu_type_e)i;
+                multicore_lockout_end_blocking();
+                config.cfg.flash_emu_type = i;
+                config_save_slow();
+                if ((i != FLASH_EMU_OFF) && capture_filter_pio)
+                {
+                    printf("note: capfilt hides commands outside %04x-%04x until reboot\n",
+                           config.cfg.capture_filter_start, config.cfg.capture_filter_start + config.cfg.capture_filter_size - 1);
+                }
+                break;
+            }
+        }
+    }
+    printf("fcmd off|29f|at29|28c|save\n");
+    printf("current fcmd: %s", flash_emu_table[flash_emu_type].name);
+    if (flash_emu_type != FLASH_EMU_OFF)
+    {
+        printf(" (id %02x %02x), program %u, erase %u%s",
+               flash_emu_table[flash_emu_type].maker_id, flash_emu_table[flash_emu_type].device_id,
+               flash_emu_program_count, flash_emu_erase_count,
+               flash_emu_dirty ? ", not saved" : "");
+    }
+    printf("\n");
+}
+
+static void cmd_wp(int argc, const char *const *argv)
+{
+    if ((argc == 2) && (strcmp(argv[1], "off") == 0))
+    {
+        config.cfg.sram_wp_size = 0;
+        printf("write protect: off\n");
+        config_save_slow();
+        reboot(REBOOT_DELAY_MS);
+        return;
+    }
+    if (argc == 3)
+    {
+        uint32_t start = strtol(argv[1], NULL, 16);
+        uint32_t end = strtol(argv[2], NULL, 16);
+        uint32_t size = end - start + 1;
+        // the block is compared in PIO: aligned power of two only
+        if ((start <= end) && (end <= 0xffff) && ((size & (size - 1)) == 0) && ((start & (size - 1)) == 0))
+        {
+            config.cfg.sram_wp_start = start;
+            config.cfg.sram_wp_size = size;
+            printf("write protect: %04x-%04x\n", start, end);
+            config_save_slow();
+            reboot(REBOOT_DELAY_MS);
+            return;
+        }
+        printf("error: range must be an aligned power of two block (e.g. 0000 7fff, c000 dfff)\n");
+    }
+    printf("wp off|start end\n");
+    if (config.cfg.sram_wp_size == 0)
+    {
+        printf("current write protect: off\n");
+    }
+    else
+    {
+        printf("current write protect: %04x-%04x\n",
+               config.cfg.sram_wp_start, config.cfg.sram_wp_start + config.cfg.sram_wp_size - 1);
+    }
+}
+
+static void cmd_extbank(int argc, const char *const *argv)
+{
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "off") == 0)
+        {
+            config.cfg.ext_bank_pin = 0;
+            printf("extbank: off\n");
+            config_save_slow();
+            reboot(REBOOT_DELAY_MS);
+            return;
+        }
+
+        char *end;
+        char *end_upper;
+        int32_t ext = strtol(argv[1], &end, 10);
+        int32_t upper = (config.cfg.rom_bank + 1) % ROM_BANK_NUM;
+        if (argc > 2)
+        {
+            upper = strtol(argv[2], &end_upper, 10);
+            if ((end_upper == argv[2]) || (*end_upper != '\0') || (upper < 0) || (upper >= ROM_BANK_NUM))
+            {
+                printf("error: illegal bank num\n");
+                return;
+            }
+        }
+        if ((end != argv[1]) && (*end == '\0') && (ext >= 0) && (ext <= 2))
+        {
+            config.cfg.ext_bank_pin = ext + 1;
+            config.cfg.ext_bank_upper = upper;
+            printf("extbank: ext%d, bank %d (ext%d=0) / bank %d (ext%d=1)\n",
+                   ext, config.cfg.rom_bank, ext, upper, ext);
+            config_save_slow();
+            reboot(REBOOT_DELAY_MS);
+            return;
+        }
+        printf("error: illegal argument\n");
+    }
+    printf("extbank off|0|1|2 [upper bank]\n");
+    if (config.cfg.ext_bank_pin == 0)
+    {
+        printf("current extbank: off\n");
+    }
+    else
+    {
+        printf("current extbank: ext%d, upper bank %d\n", config.cfg.ext_bank_pin - 1, config.cfg.ext_bank_upper);
+    }
+}
+
+static void cmd_bootsel(int argc, const char *const *argv)
+{
+    if (argc > 0)
+    {
+        uint32_t delay_ms = REBOOT_DELAY_MS;
+        delay_ms = strtol(argv[1], NULL, 10);
+        sleep_ms(delay_ms);
+    }
+    reset_usb_boot(0, 0);
+}
+
+static struct
+{
+    const char* name;
+    uint32_t pin;
+} gpio_pin_name_table[] =
+{
+    {"a0",          GPIO_ADDR + 0},
+    {"a1",          GPIO_ADDR + 1},
+    {"a2",          GPIO_ADDR + 2},
+    {"a3",          GPIO_ADDR + 3},
+    {"a4",          GPIO_ADDR + 4},
+    {"a5",          GPIO_ADDR + 5},
+    {"a6",          GPIO_ADDR + 6},
+    {"a7",          GPIO_ADDR + 7},
+    {"a8",          GPIO_ADDR + 8},
+    {"a9",          GPIO_ADDR + 9},
+    {"a10",         GPIO_ADDR + 10},
+    {"a11",         GPIO_ADDR + 11},
+    {"a12",         GPIO_ADDR + 12},
+    {"a13",         GPIO_ADDR + 13},
+    {"a14",         GPIO_ADDR + 14},
+    {"a15",         GPIO_ADDR + 15},
+    {"d0",          GPIO_DATA + 0},
+    {"d1",          GPIO_DATA + 1},
+    {"d2",          GPIO_DATA + 2},
+    {"d3",          GPIO_DATA + 3},
+    {"d4",          GPIO_DATA + 4},
+    {"d5",          GPIO_DATA + 5},
+    {"d6",          GPIO_DATA + 6},
+    {"d7",          GPIO_DATA + 7},
+    {"ce",          GPIO_CE},
+    {"oe",          GPIO_OE},
+    {"wr",          GPIO_WR},
+    {"ext0",        GPIO_EXT0},
+    {"ext1",        GPIO_EXT1},
+    {"ext2",        GPIO_EXT2},
+    {NULL,          0}
+};
+
+static uint32_t get_gpio_pin(const char *s)
+{
+    for (int32_t idx = 0; gpio_pin_name_table[idx].name != NULL; idx++)
+    {
+        if (strcmp(s, gpio_pin_name_table[idx].name) == 0)
+        {
+            return gpio_pin_name_table[idx].pin;
+        }
+    }
+    {
+        uint32_t pin;
+        char *end;
+        pin = strtol(s, &end, 10);
+        if (*end == '\0')
+        {
+            return pin;
+        }
+    }
+    return UINT32_MAX;
+}
+
+static void cmd_gpio(int argc, const char *const *argv)
+{
+    if (argc > 1)
+    {
+        uint32_t pin = UINT32_MAX;
+        if (argc == 3 && strcmp(argv[1], "in") == 0)
+        {
+            pin = get_gpio_pin(argv[2]);
+            if ((1 << pin) & GPIO_EXT_MASK)
+            {
+                gpio_config.dir &= ~(1 << pin) & GPIO_EXT_MASK;
+                gpio_set_dir_in_masked(~gpio_config.dir & GPIO_EXT_MASK);
+                return;
             }
         }
         if (argc == 3 && strcmp(argv[1], "out") == 0)
@@ -774,6 +1917,8 @@ static void cmd_device(int argc, const char *const *argv)
 {
     if (argc > 1)
     {
+        uint8_t *const prev = device;
+
         if (strcmp(argv[1], "ram") == 0)
         {
             device = ram;
@@ -787,6 +1932,11 @@ static void cmd_device(int argc, const char *const *argv)
             printf("error: unknown device. only support ram or rom\n");
             return;
         }
+        if (device != prev)
+        {
+            // detected chip size belongs to the previous device
+            send_size = sizeof(rom);
+        }
     }
     else
     {
@@ -807,6 +1957,15 @@ static void cmd_device(int argc, const char *const *argv)
     }
 }
 
+static void binport_task(void);
+
+// long running commands run until a key is pressed, binport is served meanwhile
+static bool console_idle(void)
+{
+    binport_task();
+    return getchar_timeout_us(0) == PICO_ERROR_TIMEOUT;
+}
+
 static void cmd_dump(int argc, const char *const *argv)
 {
     static uint32_t addr = 0;
@@ -827,7 +1986,7 @@ static void cmd_dump_watch(int argc, const char *const *argv)
     {
         addr = strtol(argv[1], NULL, 16);
     }
-    while (getchar_timeout_us(0) == PICO_ERROR_TIMEOUT)
+    while (console_idle())
     {
         printf("\x1b[0;0H");
         memdump(device, addr, config.cfg.dump_line_count);
@@ -1016,221 +2175,2286 @@ static void cmd_unwatch(int argc, const char *const *argv)
     }
 }
 
+static inline uint32_t capture_write_pos(void)
+{
+    return capture_deep ? busmon_cap_write_pos() : capture_wp;
+}
+
+// data of a read folded into a run record (-1: unknown)
+static int32_t capture_run_data(uint32_t cap, uint32_t addr)
+{
+    if (config.cfg.mode != CONFIG_MODE_EMULATOR)
+    {
+        return -1;
+    }
+    if (config.cfg.ext_bank_pin != 0)
+    {
+        return (cap & bit(GPIO_EXT0 + config.cfg.ext_bank_pin - 1)) ? ram[addr] : rom[addr];
+    }
+    return (romemu_selected() == 0) ? rom[addr] : ram[addr];
+}
+
+// expand a run record; suffix (timestamp) belongs to the last read
+static void capture_print_run(uint32_t cap, const char *prefix, const char *suffix)
+{
+    const uint32_t len = (cap & CAPTURE_RUN_LEN) >> CAPTURE_RUN_LEN_SHIFT;
+
+    for (uint32_t i = 0; i < len; i++)
+    {
+        const uint32_t addr = (cap + i) & 0xffff;
+        const int32_t data = capture_run_data(cap, addr);
+        if (data < 0)
+        {
+            printf("%sR:%04x:--%s\n", prefix, addr, (i == len - 1) ? suffix : "");
+        }
+        else
+        {
+            printf("%sR:%04x:%02x%s\n", prefix, addr, data, (i == len - 1) ? suffix : "");
+        }
+    }
+}
+
+typedef struct
+{
+    uint32_t stall;         // deep: PIO stalls seen so far
+    uint32_t seq;           // sequence number of the returned record
+} capture_reader_t;
+
+static void capture_reader_init(capture_reader_t *reader)
+{
+    busmon_cap_stat_t stat;
+
+    busmon_cap_get_stat(&stat);
+    reader->stall = stat.stall;
+    capture_rp = capture_write_pos() & ~(capture_record_words - 1);
+}
+
+// next watched record (false: none yet), reports lost events
+static bool capture_reader_next(capture_reader_t *reader, uint32_t *cap, uint32_t *ts)
+{
+    busmon_cap_stat_t stat;
+    const uint32_t words = capture_record_words;
+    uint32_t wp;
+    uint32_t addr;
+
+    // deep: the stall is not in the stream (normal: lost record)
+    if (capture_deep)
+    {
+        busmon_cap_get_stat(&stat);
+        if (stat.stall != reader->stall)
+        {
+            printf("# lost ? (pio stall, seq %u)\n", capture_rp / words);
+            reader->stall = stat.stall;
+        }
+    }
+    wp = capture_write_pos();
+    if (wp - capture_rp > CAPTURE_COUNT)
+    {
+        // lapped while printing
+        const uint32_t rp = (wp - CAPTURE_COUNT + words - 1) & ~(words - 1);
+        printf("# lost %d (seq %u)\n", (rp - capture_rp) / words, capture_rp / words);
+        capture_lost += (rp - capture_rp) / words;
+        capture_rp = rp;
+    }
+    if (wp - capture_rp < words)
+    {
+        return false;
+    }
+
+    *cap = work_area.capture_buffer[capture_rp % CAPTURE_COUNT];
+    *ts = (words > 1) ? work_area.capture_buffer[(capture_rp + 1) % CAPTURE_COUNT] : 0;
+    reader->seq = capture_rp / words;
+    capture_rp += words;
+    addr = *cap & 0xffff;
+    if (*cap & CAPTURE_LOST)
+    {
+        if (*cap & CAPTURE_LOST_STALL)
+        {
+            printf("# lost ? (pio stall, seq %u)\n", reader->seq);
+        }
+        if (*cap & CAPTURE_LOST_COUNT)
+        {
+            printf("# lost %d (dma ring, seq %u)\n", *cap & CAPTURE_LOST_COUNT, reader->seq);
+        }
+        return false;
+    }
+    if (capture_deep && !capture_is_target(addr))
+    {
+        return false;
+    }
+    return true;
+}
+
 static void cmd_capture(int argc, const char *const *argv)
 {
     uint32_t cap;
+    uint32_t ts;
     uint32_t addr;
     uint32_t data;
     uint32_t rw;
     static const char *str_rw = "-WRX";
 
-    capture_rp = capture_wp;
-    while (getchar_timeout_us(0) == PICO_ERROR_TIMEOUT)
+    capture_reader_t reader;
+    const uint32_t ts_ps = busmon_cap_timestamp_cycles() * (1000000000 / (clock_get_hz(clk_sys) / 1000));
+    bool ts_first = true;
+    uint32_t ts_last = 0;
+    uint64_t ts_elapsed = 0;
+    char suffix[24] = "";
+    char prefix[12] = "";
+    const bool seq = (argc > 1) && (strcmp(argv[1], "seq") == 0);
+
+    if (capture_cov)
+    {
+        printf("error: not available in capmode cov\n");
+        return;
+    }
+    capture_reader_init(&reader);
+    while (console_idle())
+    {
+        if (!capture_reader_next(&reader, &cap, &ts))
+        {
+            continue;
+        }
+        addr = cap & 0xffff;
+        data = (cap >> 16) & 0xff;
+        rw = cap >> (16 + 8 + 3 + 1);
+        if (capture_record_words > 1)
+        {
+            // timestamp counts down and wraps: accumulate the steps
+            if (ts_first)
+            {
+                ts_first = false;
+                ts_last = ts;
+            }
+            ts_elapsed += ts_last - ts;
+            ts_last = ts;
+            snprintf(suffix, sizeof(suffix), ":%llu", ts_elapsed * ts_ps / 1000);
+        }
+        if (seq)
+        {
+            snprintf(prefix, sizeof(prefix), "%u:", reader.seq);
+        }
+        if (cap & CAPTURE_RUN)
+        {
+            capture_print_run(cap, prefix, suffix);
+            continue;
+        }
+
+        printf("%s%c:%04x:%02x%s\n", prefix, str_rw[rw], addr, data, suffix);
+    }
+}
+
+typedef struct
+{
+    disasm_cpu_e cpu;
+    uint32_t org;           // CPU address of ROM address 0
+    uint8_t code[DISASM_MAX_BYTES];
+    uint32_t count;         // bytes of the pending instruction (0: none)
+    uint32_t length;        // length of the pending instruction (0: unknown)
+    uint32_t pc;            // ROM address of the pending instruction
+    uint32_t next_pc;       // ROM address expected for the next opcode
+    uint32_t data_reads;    // data reads allowed after the instruction
+    uint32_t repeat_pc;     // 1-byte instruction just fetched (0x10000: none)
+} trace_t;
+
+static void trace_flush(trace_t *t)
+{
+    char bytes[DISASM_MAX_BYTES * 3 + 1];
+    char text[32];
+
+    if (t->count == 0)
+    {
+        return;
+    }
+    for (uint32_t i = 0; i < t->count; i++)
+    {
+        snprintf(&bytes[i * 3], 4, "%02X ", t->code[i]);
+    }
+    if (t->count == t->length)
+    {
+        disasm_format(t->cpu, t->code, (t->pc + t->org) & 0xffff, text, sizeof(text));
+    }
+    else
+    {
+        // interrupted by a flow change
+        strcpy(text, "???");
+    }
+    printf("%04X  %-15s %s\n", (t->pc + t->org) & 0xffff, bytes, text);
+    t->count = 0;
+}
+
+static void trace_fetch(trace_t *t, uint8_t data)
+{
+    t->code[t->count++] = data;
+    if (t->length == 0)
+    {
+        t->length = disasm_length(t->cpu, t->code, t->count);
+    }
+    if (t->count == t->length || t->count == DISASM_MAX_BYTES)
+    {
+        t->next_pc = (t->pc + t->count) & 0xffff;
+        t->data_reads = (t->count == t->length) ? disasm_data_reads(t->cpu, t->code) : 0;
+        t->repeat_pc = (t->count == 1) ? t->pc : 0x10000;
+        trace_flush(t);
+    }
+}
+
+// classify an access as opcode, operand or data
+static void trace_access(trace_t *t, uint32_t rw, uint32_t addr, uint8_t data)
+{
+    const uint32_t repeat_pc = t->repeat_pc;
+
+    if (disasm_is_dummy(t->cpu, addr))
+    {
+        return;
+    }
+    t->repeat_pc = 0x10000;
+    if (rw == 2)
+    {
+        if (t->count == 0 && addr == repeat_pc)
+        {
+            // implied/inherent: the dummy read of the next address was taken
+            // as its opcode, this is the real fetch
+            return;
+        }
+        if (t->count != 0 && addr == ((t->pc + t->count) & 0xffff))
+        {
+            trace_fetch(t, data);
+            return;
+        }
+        if (t->count == 1 && addr == t->pc)
+        {
+            // dummy read of the opcode again
+            return;
+        }
+        if (t->count == 0 && addr != t->next_pc && t->data_reads > 0)
+        {
+            t->data_reads--;
+            printf("      R:%04X:%02X\n", (addr + t->org) & 0xffff, data);
+            return;
+        }
+        // expected next opcode or a flow change
+        trace_flush(t);
+        t->pc = addr;
+        t->length = 0;
+        t->data_reads = 0;
+        trace_fetch(t, data);
+        return;
+    }
+    printf("      %c:%04X:%02X\n", (rw == 1) ? 'W' : 'X', (addr + t->org) & 0xffff, data);
+}
+
+static void cmd_trace(int argc, const char *const *argv)
+{
+    static disasm_cpu_e trace_cpu = DISASM_6502;
+    static uint32_t trace_org = 0;
+    capture_reader_t reader;
+    trace_t t;
+    uint32_t cap;
+    uint32_t ts;
+
+    if (capture_cov)
+    {
+        printf("error: not available in capmode cov\n");
+        return;
+    }
+    if (argc >= 2)
+    {
+        if (!disasm_cpu_find(argv[1], &trace_cpu))
+        {
+            printf("error: unknown cpu %s\n", argv[1]);
+            return;
+        }
+        trace_org = (argc >= 3) ? strtol(argv[2], NULL, 16) & 0xffff : 0;
+    }
+    printf("# trace %s org %04X\n", disasm_cpu_name(trace_cpu), trace_org);
+
+    memset(&t, 0, sizeof(t));
+    t.cpu = trace_cpu;
+    t.org = trace_org;
+    t.next_pc = 0x10000;
+    t.repeat_pc = 0x10000;
+    capture_reader_init(&reader);
+    while (console_idle())
+    {
+        if (!capture_reader_next(&reader, &cap, &ts))
+        {
+            continue;
+        }
+        if (cap & CAPTURE_RUN)
+        {
+            const uint32_t len = (cap & CAPTURE_RUN_LEN) >> CAPTURE_RUN_LEN_SHIFT;
+
+            for (uint32_t i = 0; i < len; i++)
+            {
+                // snoop mode: data from the loaded image
+                const uint32_t addr = (cap + i) & 0xffff;
+                const int32_t data = capture_run_data(cap, addr);
+                trace_access(&t, 2, addr, (data < 0) ? rom[addr] : data);
+            }
+            continue;
+        }
+        trace_access(&t, cap >> 28, cap & 0xffff, (cap >> 16) & 0xff);
+    }
+    trace_flush(&t);
+}
+
+// binary capture stream (see tools/capdecode.py)
+//   word 0: magic 'R' 'B' | flags << 16 | payload words << 24
+//   word 1: sequence number of the first record
+//   word 2: lost records (cumulative)
+//   payload
+//   sum of the words above
+#define CAPBIN_MAGIC        0x4252
+#define CAPBIN_FLAG_TS      0x01    // records have timestamp
+#define CAPBIN_FLAG_START   0x40    // payload: clk_sys, timestamp cycles
+#define CAPBIN_FLAG_END     0x80
+#define CAPBIN_HEADER_WORDS 3
+#define CAPBIN_FRAME_WORDS  64
+#define CAPBIN_PAYLOAD_WORDS (CAPBIN_FRAME_WORDS - CAPBIN_HEADER_WORDS - 1)
+#define CAPBIN_ITF_CONSOLE  0
+#define CAPBIN_ITF_BINPORT  1
+
+// direct CDC access: stdio_usb runs tud_task() from a background IRQ on this
+// core, keep it out while the TinyUSB FIFO is touched
+static uint32_t cdc_read(uint8_t itf, void *buf, uint32_t len)
+{
+    const uint32_t ints = save_and_disable_interrupts();
+    const uint32_t n = tud_cdc_n_read(itf, buf, len);
+    restore_interrupts(ints);
+    return n;
+}
+
+static uint32_t cdc_write(uint8_t itf, const void *buf, uint32_t len)
+{
+    const uint32_t ints = save_and_disable_interrupts();
+    const uint32_t n = tud_cdc_n_write(itf, buf, len);
+    tud_cdc_n_write_flush(itf);
+    restore_interrupts(ints);
+    return n;
+}
+
+static uint32_t cdc_write_available(uint8_t itf)
+{
+    const uint32_t ints = save_and_disable_interrupts();
+    const uint32_t n = tud_cdc_n_write_available(itf);
+    restore_interrupts(ints);
+    return n;
+}
+
+static bool capbin_write(uint8_t itf, const void *buf, uint32_t len)
+{
+    const uint8_t *p = buf;
+
+    while (len > 0)
+    {
+        if (!tud_cdc_n_connected(itf))
+        {
+            return false;
+        }
+        const uint32_t n = cdc_write(itf, p, len);
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static bool capbin_send(uint8_t itf, uint32_t *frame, uint32_t flags, uint32_t seq, uint32_t lost, uint32_t words)
+{
+    uint32_t sum = 0;
+
+    frame[0] = CAPBIN_MAGIC | (flags << 16) | (words << 24);
+    frame[1] = seq;
+    frame[2] = lost;
+    for (uint32_t i = 0; i < CAPBIN_HEADER_WORDS + words; i++)
+    {
+        sum += frame[i];
+    }
+    frame[CAPBIN_HEADER_WORDS + words] = sum;
+
+    return capbin_write(itf, frame, (CAPBIN_HEADER_WORDS + words + 1) * sizeof(uint32_t));
+}
+
+// copy new records from rp into the payload, returns the number of words
+// lost: records skipped in the sequence (losses before core1 are lost records in the payload)
+static uint32_t capbin_fill(uint32_t *frame, uint32_t *rp, uint32_t *lost)
+{
+    const uint32_t words = capture_record_words;
+    const uint32_t max_words = CAPBIN_PAYLOAD_WORDS & ~(words - 1);
+    uint32_t wp;
+    uint32_t n;
+
+    wp = capture_write_pos();
+    if (wp - *rp > CAPTURE_COUNT)
+    {
+        const uint32_t pos = (wp - CAPTURE_COUNT + words - 1) & ~(words - 1);
+        *lost += (pos - *rp) / words;
+        capture_lost += (pos - *rp) / words;
+        *rp = pos;
+    }
+    n = (wp - *rp) & ~(words - 1);
+    if (n > max_words)
+    {
+        n = max_words;
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+        frame[CAPBIN_HEADER_WORDS + i] = work_area.capture_buffer[(*rp + i) % CAPTURE_COUNT];
+    }
+    // overwritten while copying: counted as lost on the next round
+    if (capture_write_pos() - *rp > CAPTURE_COUNT)
+    {
+        return 0;
+    }
+    return n;
+}
+
+static void cmd_capture_binary(int argc, const char *const *argv)
+{
+    uint32_t frame[CAPBIN_FRAME_WORDS];
+    uint32_t lost = 0;
+    const uint32_t words = capture_record_words;
+    const uint32_t flags = (words > 1) ? CAPBIN_FLAG_TS : 0;
+
+    if (capture_cov)
+    {
+        printf("error: not available in capmode cov\n");
+        return;
+    }
+    stdio_flush();
+
+    frame[CAPBIN_HEADER_WORDS + 0] = clock_get_hz(clk_sys);
+    frame[CAPBIN_HEADER_WORDS + 1] = busmon_cap_timestamp_cycles();
+    capture_rp = capture_write_pos() & ~(words - 1);
+    if (!capbin_send(CAPBIN_ITF_CONSOLE, frame, flags | CAPBIN_FLAG_START, capture_rp / words, 0, 2))
+    {
+        return;
+    }
+
+    while (console_idle())
+    {
+        const uint32_t n = capbin_fill(frame, &capture_rp, &lost);
+        if (n == 0)
+        {
+            continue;
+        }
+        if (!capbin_send(CAPBIN_ITF_CONSOLE, frame, flags, capture_rp / words, lost, n))
+        {
+            return;
+        }
+        capture_rp += n;
+    }
+
+    capbin_send(CAPBIN_ITF_CONSOLE, frame, flags | CAPBIN_FLAG_END, capture_rp / words, lost, 0);
+}
+
+// binary protocol on the second CDC interface (see tools/binport.py)
+//   request:  magic 'B' 'P', cmd, target, addr, len, arg (16 bytes)
+//             WRITE is followed by len bytes of data
+//   response: magic 'B' 'P', cmd, status, value, len, extra (16 bytes)
+//             READ and INFO are followed by len bytes of data
+// capture frames of CAP_START are the same as capbin.
+#define BINPORT_MAGIC       0x5042
+#define BINPORT_HEADER_SIZE 16
+
+typedef enum
+{
+    BINPORT_CMD_INFO = 0x01,
+    BINPORT_CMD_READ = 0x02,
+    BINPORT_CMD_WRITE = 0x03,
+    BINPORT_CMD_FILL = 0x04,        // arg: value
+    BINPORT_CMD_SUM = 0x05,         // value: crc32, extra: sum
+    BINPORT_CMD_LOAD = 0x06,        // arg: flash rom bank
+    BINPORT_CMD_SAVE = 0x07,        // arg: flash rom bank
+    BINPORT_CMD_CAP_START = 0x08,
+    BINPORT_CMD_CAP_STOP = 0x09,
+} binport_cmd_e;
+
+typedef enum
+{
+    BINPORT_STATUS_OK = 0,
+    BINPORT_STATUS_BAD_CMD = 1,
+    BINPORT_STATUS_BAD_RANGE = 2,
+    BINPORT_STATUS_BAD_ARG = 3,
+    BINPORT_STATUS_NOT_AVAILABLE = 4,
+    BINPORT_STATUS_FAILED = 5,
+} binport_status_e;
+
+typedef enum
+{
+    BINPORT_STATE_HEADER,
+    BINPORT_STATE_WRITE_DATA,
+    BINPORT_STATE_READ_DATA,
+} binport_state_e;
+
+typedef struct
+{
+    uint16_t magic;
+    uint8_t cmd;
+    uint8_t target;         // 0: rom, 1: ram
+    uint32_t addr;
+    uint32_t len;
+    uint32_t arg;
+} binport_req_t;
+
+typedef struct
+{
+    uint16_t magic;
+    uint8_t cmd;
+    uint8_t status;
+    uint32_t value;
+    uint32_t len;
+    uint32_t extra;
+} binport_rsp_t;
+
+_Static_assert(sizeof(binport_req_t) == BINPORT_HEADER_SIZE, "binport request size");
+_Static_assert(sizeof(binport_rsp_t) == BINPORT_HEADER_SIZE, "binport response size");
+
+static binport_state_e binport_state = BINPORT_STATE_HEADER;
+static binport_req_t binport_req;
+static uint32_t binport_got;            // header bytes received
+static uint8_t *binport_data;           // NULL: discard WRITE data
+static uint32_t binport_remain;
+static uint32_t binport_discard_status; // response after discarding WRITE data
+static bool binport_cap = false;
+static uint32_t binport_cap_rp;
+static uint32_t binport_cap_lost;
+
+static void binport_respond(uint32_t status, uint32_t value, uint32_t len, uint32_t extra)
+{
+    const binport_rsp_t rsp = {
+        .magic = BINPORT_MAGIC,
+        .cmd = binport_req.cmd,
+        .status = status,
+        .value = value,
+        .len = len,
+        .extra = extra,
+    };
+
+    capbin_write(CAPBIN_ITF_BINPORT, &rsp, sizeof(rsp));
+}
+
+static bool binport_cap_send(uint32_t flags, uint32_t words)
+{
+    static uint32_t frame[CAPBIN_FRAME_WORDS];
+    const uint32_t record_words = capture_record_words;
+
+    flags |= (record_words > 1) ? CAPBIN_FLAG_TS : 0;
+    if (flags & CAPBIN_FLAG_START)
+    {
+        frame[CAPBIN_HEADER_WORDS + 0] = clock_get_hz(clk_sys);
+        frame[CAPBIN_HEADER_WORDS + 1] = busmon_cap_timestamp_cycles();
+    }
+    else if (!(flags & CAPBIN_FLAG_END))
+    {
+        // do not block the requests: wait for room of a whole frame
+        if (cdc_write_available(CAPBIN_ITF_BINPORT) < sizeof(frame))
+        {
+            return false;
+        }
+        words = capbin_fill(frame, &binport_cap_rp, &binport_cap_lost);
+        if (words == 0)
+        {
+            return false;
+        }
+    }
+    capbin_send(CAPBIN_ITF_BINPORT, frame, flags, binport_cap_rp / record_words, binport_cap_lost, words);
+    binport_cap_rp += (flags & CAPBIN_FLAG_START) ? 0 : words;
+    return true;
+}
+
+static void binport_request(void)
+{
+    const binport_req_t *req = &binport_req;
+    // target 0: the image being served (follows swap), 1: the other slot
+    uint8_t *const active = rom_active();
+    uint8_t *mem = (req->target == 0) ? active : (req->target == 1) ? ((active == rom) ? ram : rom) : NULL;
+    const bool in_range = (req->addr < sizeof(rom)) && (req->len <= sizeof(rom) - req->addr);
+
+    switch (req->cmd)
+    {
+    case BINPORT_CMD_INFO:
+        binport_respond(BINPORT_STATUS_OK, config.cfg.mode, strlen(MAGIC_STR), capture_record_words);
+        capbin_write(CAPBIN_ITF_BINPORT, MAGIC_STR, strlen(MAGIC_STR));
+        return;
+    case BINPORT_CMD_CAP_START:
+        if (capture_cov)
+        {
+            binport_respond(BINPORT_STATUS_NOT_AVAILABLE, 0, 0, 0);
+            return;
+        }
+        binport_respond(BINPORT_STATUS_OK, capture_record_words, 0, 0);
+        binport_cap_lost = 0;
+        binport_cap_rp = capture_write_pos() & ~(capture_record_words - 1);
+        binport_cap_send(CAPBIN_FLAG_START, 2);
+        binport_cap = true;
+        return;
+    case BINPORT_CMD_CAP_STOP:
+        if (binport_cap)
+        {
+            binport_cap = false;
+            binport_cap_send(CAPBIN_FLAG_END, 0);
+        }
+        binport_respond(BINPORT_STATUS_OK, 0, 0, 0);
+        return;
+    case BINPORT_CMD_READ:
+    case BINPORT_CMD_WRITE:
+    case BINPORT_CMD_FILL:
+    case BINPORT_CMD_SUM:
+    case BINPORT_CMD_LOAD:
+    case BINPORT_CMD_SAVE:
+        break;
+    default:
+        binport_respond(BINPORT_STATUS_BAD_CMD, 0, 0, 0);
+        return;
+    }
+
+    if ((mem == NULL) || !in_range)
+    {
+        const uint32_t status = (mem == NULL) ? BINPORT_STATUS_BAD_ARG : BINPORT_STATUS_BAD_RANGE;
+        if ((req->cmd == BINPORT_CMD_WRITE) && (req->len != 0))
+        {
+            // keep in sync with the host: discard the whole payload
+            binport_data = NULL;
+            binport_remain = req->len;
+            binport_discard_status = status;
+            binport_state = BINPORT_STATE_WRITE_DATA;
+            return;
+        }
+        binport_respond(status, 0, 0, 0);
+        return;
+    }
+
+    switch (req->cmd)
+    {
+    case BINPORT_CMD_READ:
+        binport_respond(BINPORT_STATUS_OK, 0, req->len, 0);
+        binport_data = &mem[req->addr];
+        binport_remain = req->len;
+        binport_state = BINPORT_STATE_READ_DATA;
+        break;
+    case BINPORT_CMD_WRITE:
+        // received directly into the image
+        binport_data = &mem[req->addr];
+        binport_remain = req->len;
+        binport_state = BINPORT_STATE_WRITE_DATA;
+        if (mem == device)
+        {
+            send_size = sizeof(rom);
+        }
+        break;
+    case BINPORT_CMD_FILL:
+        memset(&mem[req->addr], req->arg, req->len);
+        binport_respond(BINPORT_STATUS_OK, 0, 0, 0);
+        break;
+    case BINPORT_CMD_SUM:
+        if (req->len == 0)
+        {
+            binport_respond(BINPORT_STATUS_BAD_RANGE, 0, 0, 0);
+            break;
+        }
+        binport_respond(BINPORT_STATUS_OK,
+                        dma_sniff(&mem[req->addr], req->len, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, 0xffffffff, true),
+                        0,
+                        dma_sniff(&mem[req->addr], req->len, DMA_SNIFF_CTRL_CALC_VALUE_SUM, 0, false));
+        break;
+    case BINPORT_CMD_LOAD:
+    case BINPORT_CMD_SAVE:
+        if ((req->arg >= ROM_BANK_NUM) || ((req->cmd == BINPORT_CMD_SAVE) && (mem != active)))
+        {
+            binport_respond(BINPORT_STATUS_BAD_ARG, 0, 0, 0);
+            break;
+        }
+        if (req->cmd == BINPORT_CMD_LOAD)
+        {
+            rom_load_slow(mem, req->arg);
+            binport_respond(BINPORT_STATUS_OK, 0, 0, 0);
+        }
+        else
+        {
+            binport_respond(rom_save_slow(mem, req->arg) ? BINPORT_STATUS_OK : BINPORT_STATUS_FAILED, 0, 0, 0);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// called from the main loop: serves one step of the binary protocol
+static void binport_task(void)
+{
+    uint8_t *header = (uint8_t *)&binport_req;
+    uint8_t discard[64];
+    uint32_t n;
+
+    switch (binport_state)
+    {
+    case BINPORT_STATE_HEADER:
+        if (binport_cap)
+        {
+            binport_cap_send(0, 0);
+        }
+        n = cdc_read(CAPBIN_ITF_BINPORT, &header[binport_got], BINPORT_HEADER_SIZE - binport_got);
+        binport_got += n;
+        if (binport_got < BINPORT_HEADER_SIZE)
+        {
+            return;
+        }
+        if (binport_req.magic != BINPORT_MAGIC)
+        {
+            // resync on the next byte
+            memmove(header, header + 1, BINPORT_HEADER_SIZE - 1);
+            binport_got = BINPORT_HEADER_SIZE - 1;
+            return;
+        }
+        binport_got = 0;
+        binport_request();
+        break;
+    case BINPORT_STATE_WRITE_DATA:
+        if (binport_data == NULL)
+        {
+            n = cdc_read(CAPBIN_ITF_BINPORT, discard, (binport_remain < sizeof(discard)) ? binport_remain : sizeof(discard));
+        }
+        else
+        {
+            n = cdc_read(CAPBIN_ITF_BINPORT, binport_data, binport_remain);
+            binport_data += n;
+        }
+        binport_remain -= n;
+        if (binport_remain == 0)
+        {
+            binport_state = BINPORT_STATE_HEADER;
+            binport_respond((binport_data == NULL) ? binport_discard_status : BINPORT_STATUS_OK, 0, 0, 0);
+        }
+        break;
+    case BINPORT_STATE_READ_DATA:
+        n = cdc_write(CAPBIN_ITF_BINPORT, binport_data, binport_remain);
+        binport_data += n;
+        binport_remain -= n;
+        if (binport_remain == 0)
+        {
+            binport_state = BINPORT_STATE_HEADER;
+        }
+        break;
+    }
+}
+
+// print runs of set bits
+static uint32_t cov_print_ranges(const uint32_t *map, uint32_t start, uint32_t end)
+{
+    uint32_t addr = start;
+    uint32_t count = 0;
+
+    while ((addr = bitmap_find(map, addr, end, true)) <= end)
+    {
+        const uint32_t next = bitmap_find(map, addr, end, false);
+        printf("  %04x-%04x\n", addr, next - 1);
+        count += next - addr;
+        addr = next;
+    }
+    return count;
+}
+
+static void cmd_coverage(int argc, const char *const *argv)
+{
+    uint32_t start = 0x0000;
+    uint32_t end = 0xffff;
+    bool write = false;
+
+    if (!capture_cov)
+    {
+        printf("error: only available in capmode cov\n");
+        return;
+    }
+    if ((argc > 1) && (strcmp(argv[1], "clear") == 0))
+    {
+        memset(&work_area.cov, 0, sizeof(work_area.cov));
+        printf("coverage cleared\n");
+        return;
+    }
+    if ((argc > 1) && (strcmp(argv[1], "send") == 0))
+    {
+        // read bitmap, write bitmap, hot counters (little endian)
+        printf("send coverage to host (XMODEM 1K, %d bytes)\n", (int)sizeof(work_area.cov));
+        XmodemTransmit1K(NULL, (uint8_t *)&work_area.cov, sizeof(work_area.cov));
+        sleep_ms(1000);
+        printf("done.\n");
+        return;
+    }
+    if ((argc > 1) && ((strcmp(argv[1], "read") == 0) || (strcmp(argv[1], "write") == 0)))
+    {
+        write = (strcmp(argv[1], "write") == 0);
+        argc--;
+        argv++;
+    }
+    if (argc > 2)
+    {
+        start = strtol(argv[1], NULL, 16) & 0xffff;
+        end = strtol(argv[2], NULL, 16) & 0xffff;
+    }
+    else if (argc > 1)
+    {
+        printf("cov [read|write] [start end]\n");
+        printf("cov clear|send\n");
+        return;
+    }
+    if (start > end)
+    {
+        printf("error: illegal range\n");
+        return;
+    }
+
+    printf("%s coverage %04x-%04x\n", write ? "write" : "read", start, end);
+    const uint32_t count = cov_print_ranges(write ? work_area.cov.write : work_area.cov.read, start, end);
+    printf("%d / %d addresses\n", count, end - start + 1);
+}
+
+// indexes of the num largest counts (0: not counted) in descending order,
+// returns the number of them
+static uint32_t top_count(uint32_t (*count)(const void *ctx, uint32_t i), const void *ctx,
+                          uint32_t size, uint16_t *top, uint32_t num)
+{
+    uint32_t n = 0;
+
+    // keep the top entries sorted by insertion
+    for (uint32_t i = 0; i < size; i++)
+    {
+        const uint32_t c = count(ctx, i);
+        if ((c == 0) || ((n == num) && (c <= count(ctx, top[n - 1]))))
+        {
+            continue;
+        }
+        uint32_t j = (n < num) ? n++ : n - 1;
+        while ((j > 0) && (count(ctx, top[j - 1]) < c))
+        {
+            top[j] = top[j - 1];
+            j--;
+        }
+        top[j] = i;
+    }
+    return n;
+}
+
+static uint32_t hot_count(const void *ctx, uint32_t i)
+{
+    return ((const uint16_t *)ctx)[i];
+}
+
+#define HOT_MAX 64
+
+static void cmd_hot(int argc, const char *const *argv)
+{
+    uint16_t top[HOT_MAX];
+    uint32_t num = 16;
+    uint32_t n;
+    uint32_t total = 0;
+
+    if (!capture_cov)
+    {
+        printf("error: only available in capmode cov\n");
+        return;
+    }
+    if (argc > 1)
+    {
+        num = strtol(argv[1], NULL, 10);
+        if ((num == 0) || (num > HOT_MAX))
+        {
+            num = HOT_MAX;
+        }
+    }
+
+    for (uint32_t i = 0; i < count_of(work_area.cov.count); i++)
+    {
+        total += work_area.cov.count[i];
+    }
+    n = top_count(hot_count, work_area.cov.count, count_of(work_area.cov.count), top, num);
+
+    printf("block      reads  permil\n");
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const uint32_t c = work_area.cov.count[top[i]];
+        printf("%04x-%04x %5d%c %4d\n",
+               top[i] * COV_BLOCK_SIZE, top[i] * COV_BLOCK_SIZE + COV_BLOCK_SIZE - 1,
+               c, (c == 0xffff) ? '+' : ' ', (uint32_t)((uint64_t)c * 1000 / total));
+    }
+}
+
+// core1 may be inside prof_event: clear while it is locked out
+static void prof_clear(void)
+{
+    multicore_lockout_start_blocking();
+    memset(prof_bin, 0, sizeof(prof_bin));
+    prof_other = 0;
+    prof_samples = 0;
+    prof_skip = 0;
+    multicore_lockout_end_blocking();
+}
+
+static uint32_t prof_count(const void *ctx, uint32_t i)
+{
+    return ((const uint32_t *)ctx)[i];
+}
+
+static void prof_show(uint32_t num)
+{
+    uint16_t top[PROF_SYM_MAX];
+    const uint32_t bins = (prof_sym_num != 0) ? prof_sym_num : PROF_BINS;
+    const uint32_t samples = prof_samples;
+    uint32_t n;
+
+    if (num > PROF_SYM_MAX)
+    {
+        num = PROF_SYM_MAX;
+    }
+    printf("profiler: %s, every %d %s, %s, %u samples\n",
+           prof_enable ? "on" : "off", prof_interval, prof_by_time ? "us" : "reads",
+           (prof_sym_num != 0) ? "symbols" : "bins", samples);
+    if (samples == 0)
+    {
+        return;
+    }
+    n = top_count(prof_count, prof_bin, bins, top, num);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const uint32_t c = prof_bin[top[i]];
+        const uint32_t permil = (uint32_t)((uint64_t)c * 1000 / samples);
+        if (prof_sym_num != 0)
+        {
+            printf("%-12s %04x-%04x", prof_sym[top[i]].name, prof_sym[top[i]].start, prof_sym[top[i]].end);
+        }
+        else
+        {
+            const uint32_t start = prof_base + (top[i] << prof_shift);
+            printf("%04x-%04x   ", start, start + (1 << prof_shift) - 1);
+        }
+        printf(" %10u %3d.%d%%\n", c, permil / 10, permil % 10);
+    }
+    const uint32_t permil = (uint32_t)((uint64_t)prof_other * 1000 / samples);
+    printf("(other)                 %10u %3d.%d%%\n", prof_other, permil / 10, permil % 10);
+}
+
+static void cmd_prof(int argc, const char *const *argv)
+{
+    if (capture_deep)
+    {
+        printf("error: not available in capmode deep\n");
+        return;
+    }
+    if ((argc > 1) && (strcmp(argv[1], "on") == 0))
+    {
+        prof_last = time_us_32();
+        prof_enable = true;
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "off") == 0))
+    {
+        prof_enable = false;
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "clear") == 0))
+    {
+        prof_clear();
+    }
+    else if ((argc > 2) && ((strcmp(argv[1], "us") == 0) || (strcmp(argv[1], "reads") == 0)))
+    {
+        const uint32_t interval = strtol(argv[2], NULL, 10);
+        if (interval == 0)
+        {
+            printf("error: illegal interval\n");
+            return;
+        }
+        prof_enable = false;
+        prof_by_time = (strcmp(argv[1], "us") == 0);
+        prof_interval = interval;
+        prof_clear();
+    }
+    else if ((argc > 2) && (strcmp(argv[1], "bin") == 0))
+    {
+        const uint32_t size = strtol(argv[2], NULL, 10);
+        if ((size != 16) && (size != 64) && (size != 256))
+        {
+            printf("error: bin size must be 16, 64 or 256\n");
+            return;
+        }
+        prof_enable = false;
+        prof_shift = __builtin_ctz(size);
+        prof_base = (argc > 3) ? strtol(argv[3], NULL, 16) & 0xffff : 0;
+        prof_sym_num = 0;
+        prof_clear();
+        printf("bins: %04x-%04x\n", prof_base, prof_base + (PROF_BINS << prof_shift) - 1);
+    }
+    else if ((argc > 2) && (strcmp(argv[1], "sym") == 0) && (strcmp(argv[2], "clear") == 0))
+    {
+        prof_enable = false;
+        prof_sym_num = 0;
+        prof_clear();
+    }
+    else if ((argc > 4) && (strcmp(argv[1], "sym") == 0))
+    {
+        if (prof_sym_num >= PROF_SYM_MAX)
+        {
+            printf("error: too many symbols\n");
+            return;
+        }
+        prof_sym_t *sym = &prof_sym[prof_sym_num];
+        prof_enable = false;
+        strncpy(sym->name, argv[2], PROF_SYM_NAME_SIZE - 1);
+        sym->name[PROF_SYM_NAME_SIZE - 1] = '\0';
+        sym->start = strtol(argv[3], NULL, 16) & 0xffff;
+        sym->end = strtol(argv[4], NULL, 16) & 0xffff;
+        prof_sym_num++;
+        prof_clear();
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "show") == 0))
+    {
+        prof_show((argc > 2) ? strtol(argv[2], NULL, 10) : 16);
+        return;
+    }
+    else if (argc > 1)
+    {
+        printf("prof on|off|clear|show [n]\n");
+        printf("prof us n|reads n\n");
+        printf("prof bin 16|64|256 [base]\n");
+        printf("prof sym name start end|sym clear\n");
+        return;
+    }
+    prof_show(16);
+}
+
+// as prof_clear, core1 may be inside edge_event
+static void edge_clear(void)
+{
+    multicore_lockout_start_blocking();
+    memset(edge_table, 0, sizeof(edge_table));
+    memset(edge_block, 0, sizeof(edge_block));
+    edge_last = 0x10000;
+    edge_reads = 0;
+    edge_count = 0;
+    edge_dropped = 0;
+    multicore_lockout_end_blocking();
+}
+
+static uint32_t edge_entry_count(const void *ctx, uint32_t i)
+{
+    const edge_entry_t *e = &((const edge_entry_t *)ctx)[i];
+    return e->used ? e->count : 0;
+}
+
+static void edge_show(bool blocks, uint32_t num)
+{
+    uint16_t top[EDGE_SHOW_MAX];
+    const edge_entry_t *table = blocks ? edge_block : edge_table;
+    const uint32_t total = edge_count;
+    uint32_t n;
+
+    if (num > EDGE_SHOW_MAX)
+    {
+        num = EDGE_SHOW_MAX;
+    }
+    printf("edges: %s, %u reads, %u transitions, %u dropped\n",
+           edge_enable ? "on" : "off", edge_reads, total, edge_dropped);
+    if (total == 0)
+    {
+        return;
+    }
+    n = top_count(edge_entry_count, table, blocks ? EDGE_BLOCK_SIZE : EDGE_TABLE_SIZE, top, num);
+    for (uint32_t i = 0; i < n; i++)
+    {
+        const edge_entry_t *e = &table[top[i]];
+        const uint32_t from = e->key >> 16;
+        const uint32_t to = e->key & 0xffff;
+        const uint32_t permil = (uint32_t)((uint64_t)e->count * 1000 / total);
+        if (blocks)
+        {
+            printf("%04x-%04x %5d bytes", from, to, (to - from + 1) & 0xffff);
+        }
+        else
+        {
+            printf("%04x->%04x %-10s", from, to, (to < from) ? "backward" : "forward");
+        }
+        printf(" %10u %3d.%d%%\n", e->count, permil / 10, permil % 10);
+    }
+}
+
+static void cmd_edges(int argc, const char *const *argv)
+{
+    if (capture_deep)
+    {
+        printf("error: not available in capmode deep\n");
+        return;
+    }
+    if ((argc > 1) && (strcmp(argv[1], "on") == 0))
+    {
+        edge_last = 0x10000;
+        edge_enable = true;
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "off") == 0))
+    {
+        edge_enable = false;
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "clear") == 0))
+    {
+        edge_clear();
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "blocks") == 0))
+    {
+        edge_show(true, (argc > 2) ? strtol(argv[2], NULL, 10) : 16);
+        return;
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "show") == 0))
+    {
+        edge_show(false, (argc > 2) ? strtol(argv[2], NULL, 10) : 16);
+        return;
+    }
+    else if (argc > 1)
+    {
+        printf("edges on|off|clear|show [n]|blocks [n]\n");
+        return;
+    }
+    edge_show(false, 16);
+}
+
+// "value", "value/mask" or "-" (don't care)
+static void parse_match(const char *str, uint32_t full, uint32_t shift, trig_cond_t *cond)
+{
+    uint32_t value;
+    uint32_t mask = full;
+    char *end;
+
+    if (strcmp(str, "-") == 0)
+    {
+        return;
+    }
+    value = strtol(str, &end, 16);
+    if (*end == '/')
+    {
+        mask = strtol(end + 1, NULL, 16) & full;
+    }
+    cond->mask |= mask << shift;
+    cond->match |= (value & mask) << shift;
+}
+
+static void print_trig_cond(const char *name, const trig_cond_t *cond)
+{
+    static const char *str_rw = "-WRX";
+
+    if (!cond->enable)
+    {
+        printf("%s: off\n", name);
+        return;
+    }
+    printf("%s: addr %04x/%04x data %02x/%02x rw %c ext %x/%x\n", name,
+           cond->match & 0xffff, cond->mask & 0xffff,
+           (cond->match >> 16) & 0xff, (cond->mask >> 16) & 0xff,
+           ((cond->mask >> TRIG_RW_SHIFT) & 3) ? str_rw[(cond->match >> TRIG_RW_SHIFT) & 3] : '-',
+           (cond->match >> 24) & 7, (cond->mask >> 24) & 7);
+}
+
+static void trig_show(void)
+{
+    static const char *str_rw = "-WRX";
+    const uint32_t words = capture_record_words;
+    const uint32_t pos = trig_pos;
+    const uint32_t start = pos - trig_pre * words;
+    const uint32_t end = capture_wp;
+
+    if ((trig_state != TRIG_STATE_FIRED) && (trig_state != TRIG_STATE_DONE))
+    {
+        printf("not triggered\n");
+        return;
+    }
+    if (!trig_pos_stored)
+    {
+        printf("# trigger event is not in the watch area\n");
+    }
+    for (uint32_t i = start; i != end; i += words)
+    {
+        // entries older than the buffer or before the capture started
+        if ((capture_wp - i > CAPTURE_COUNT) || ((int32_t)(i - pos) < -(int32_t)pos))
+        {
+            continue;
+        }
+        const uint32_t cap = work_area.capture_buffer[i % CAPTURE_COUNT];
+        if (cap & CAPTURE_LOST)
+        {
+            if (cap & CAPTURE_LOST_STALL)
+            {
+                printf("        # lost ? (pio stall)\n");
+            }
+            if (cap & CAPTURE_LOST_COUNT)
+            {
+                printf("        # lost %d (dma ring)\n", cap & CAPTURE_LOST_COUNT);
+            }
+            continue;
+        }
+        if (cap & CAPTURE_RUN)
+        {
+            printf(" %+6d R:%04x +%d sequential reads\n", (int32_t)(i - pos) / (int32_t)words,
+                   cap & 0xffff, (cap & CAPTURE_RUN_LEN) >> CAPTURE_RUN_LEN_SHIFT);
+            continue;
+        }
+        printf("%c%+6d %c:%04x:%02x\n",
+               ((i == pos) && trig_pos_stored) ? 'T' : ' ', (int32_t)(i - pos) / (int32_t)words,
+               str_rw[cap >> (16 + 8 + 3 + 1)], cap & 0xffff, (cap >> 16) & 0xff);
+    }
+}
+
+static void cmd_trigger(int argc, const char *const *argv)
+{
+    static const char *str_state[] = {"idle", "armed", "armed (A matched)", "triggered", "done"};
+
+    if (capture_deep || capture_cov)
+    {
+        printf("error: not available in capmode %s\n", capture_cov ? "cov" : "deep");
+        return;
+    }
+    if ((argc > 2) && ((strcmp(argv[1], "a") == 0) || (strcmp(argv[1], "b") == 0)))
+    {
+        trig_cond_t cond = {true, 0, 0};
+        const int32_t n = (argv[1][0] == 'a') ? 0 : 1;
+
+        if (strcmp(argv[2], "off") == 0)
+        {
+            cond.enable = false;
+        }
+        else
+        {
+            parse_match(argv[2], 0xffff, 0, &cond);
+            if (argc > 3)
+            {
+                parse_match(argv[3], 0xff, 16, &cond);
+            }
+            if ((argc > 4) && ((argv[4][0] == 'r') || (argv[4][0] == 'w')))
+            {
+                cond.mask |= 3 << TRIG_RW_SHIFT;
+                cond.match |= ((argv[4][0] == 'r') ? 2 : 1) << TRIG_RW_SHIFT;
+            }
+            if (argc > 5)
+            {
+                parse_match(argv[5], 0x7, 24, &cond);
+            }
+        }
+        trig_state = TRIG_STATE_IDLE;
+        trig_cond[n] = cond;
+    }
+    else if ((argc > 2) && (strcmp(argv[1], "within") == 0))
+    {
+        trig_within = strtol(argv[2], NULL, 10);
+    }
+    else if ((argc > 2) && (strcmp(argv[1], "count") == 0))
+    {
+        trig_count = strtol(argv[2], NULL, 10);
+    }
+    else if ((argc > 3) && (strcmp(argv[1], "window") == 0))
+    {
+        uint32_t pre = strtol(argv[2], NULL, 10);
+        uint32_t post = strtol(argv[3], NULL, 10);
+        if ((pre + post + 1) * capture_record_words > CAPTURE_COUNT)
+        {
+            printf("error: pre + post must be less than %d\n", CAPTURE_COUNT / capture_record_words);
+            return;
+        }
+        trig_pre = pre;
+        trig_post = post;
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "arm") == 0))
+    {
+        if (!trig_cond[0].enable)
+        {
+            printf("error: condition a is not set\n");
+            return;
+        }
+        trig_state = TRIG_STATE_IDLE;
+        trig_occurrence = 0;
+        trig_state = TRIG_STATE_ARMED;
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "stop") == 0))
+    {
+        trig_state = TRIG_STATE_IDLE;
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "show") == 0))
+    {
+        trig_show();
+        return;
+    }
+    else if (argc > 1)
+    {
+        printf("trig a|b addr[/mask] [data[/mask] [r|w|- [ext[/mask]]]]\n");
+        printf("trig a|b off\n");
+        printf("trig within n|count n|window pre post\n");
+        printf("trig arm|stop|show\n");
+        return;
+    }
+
+    print_trig_cond("a", &trig_cond[0]);
+    print_trig_cond("b", &trig_cond[1]);
+    printf("within: %d, count: %d, window: %d/%d\n", trig_within, trig_count, trig_pre, trig_post);
+    printf("state: %s\n", str_state[trig_state]);
+}
+
+static void cmd_list_watch(int argc, const char *const *argv)
+{
+    uint32_t start = 0x0000;
+    uint32_t end = 0xffff;
+    uint32_t addr;
+    const char *format = "%04x %04x\n";
+
+    if (argc > 1)
+    {
+        start = strtol(argv[1], NULL, 16) & 0xffff;
+    }
+    if (argc > 2)
+    {
+        end = strtol(argv[2], NULL, 16) & 0xffff;
+    }
+
+    addr = start;
+    while ((addr = capture_target_find(addr, end, true)) <= end)
+    {
+        const uint32_t next = capture_target_find(addr, end, false);
+        printf(format, addr, next - 1);
+        addr = next;
+    }
+}
+
+static void cmd_watch_op(int argc, const char *const *argv)
+{
+    uint32_t start = 0x0000;
+    uint32_t end = 0xffff;
+
+    if (argc > 3)
+    {
+        start = strtol(argv[2], NULL, 16) & 0xffff;
+        end = strtol(argv[3], NULL, 16) & 0xffff;
+        if (start > end)
+        {
+            printf("error: illegal range\n");
+            return;
+        }
+    }
+    if ((argc > 1) && (strcmp(argv[1], "clear") == 0))
+    {
+        capture_target_update(0x0000, 0xffff, BITMAP_CLEAR);
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "all") == 0))
+    {
+        capture_target_update(0x0000, 0xffff, BITMAP_SET);
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "inv") == 0))
+    {
+        capture_target_update(start, end, BITMAP_INVERT);
+    }
+    else if ((argc > 3) && (strcmp(argv[1], "and") == 0))
+    {
+        // intersect with the range: unwatch everything outside of it
+        if (start > 0x0000)
+        {
+            capture_target_update(0x0000, start - 1, BITMAP_CLEAR);
+        }
+        if (end < 0xffff)
+        {
+            capture_target_update(end + 1, 0xffff, BITMAP_CLEAR);
+        }
+    }
+    else if ((argc > 1) && (strcmp(argv[1], "load") == 0))
+    {
+        char buffer[16];
+
+        // replace with a range list ("start end" or "start-end" per line)
+        capture_target_update(0x0000, 0xffff, BITMAP_CLEAR);
+        printf("range list end with '.'\n");
+        for (;;)
+        {
+            char *p;
+            printf(": ");
+            readline(buffer, sizeof(buffer));
+            if (buffer[0] == '.')
+            {
+                break;
+            }
+            start = strtol(buffer, &p, 16) & 0xffff;
+            if (p == buffer)
+            {
+                continue;
+            }
+            while ((*p == ' ') || (*p == '-'))
+            {
+                p++;
+            }
+            end = (*p != '\0') ? strtol(p, NULL, 16) & 0xffff : start;
+            if (start <= end)
+            {
+                capture_target_update(start, end, BITMAP_SET);
+            }
+        }
+    }
+    else
+    {
+        printf("wop clear|all|inv [start end]|and start end|load\n");
+        return;
+    }
+    printf("done.\n");
+}
+
+static void cmd_save_watch(int argc, const char *const *argv)
+{
+    const watch_profile_t *current = &config.cfg.watch[config.cfg.watch_profile];
+    const char *name = (argc > 1) ? argv[1] : (current->name[0] != '\0') ? current->name : "default";
+    int32_t n = watch_profile_find(name);
+    watch_profile_t profile;
+
+    if (n < 0)
+    {
+        // unused slot
+        for (n = 0; (n < WATCH_PROFILE_NUM) && (config.cfg.watch[n].name[0] != '\0'); n++)
+        {
+        }
+        if (n == WATCH_PROFILE_NUM)
+        {
+            printf("error: too many profiles (max %d)\n", WATCH_PROFILE_NUM);
+            return;
+        }
+    }
+    if (!watch_profile_store(&profile, name))
+    {
+        printf("error: too many ranges (max %d)\n", WATCH_RANGE_MAX);
+        return;
+    }
+    printf("save capture area as %s (%d ranges) ... ", profile.name, profile.count);
+    config.cfg.watch[n] = profile;
+    config.cfg.watch_profile = n;
+    config_save_slow();
+    printf("done.\n");
+}
+
+static void cmd_watch_profile(int argc, const char *const *argv)
+{
+    if ((argc > 2) && ((strcmp(argv[1], "load") == 0) || (strcmp(argv[1], "del") == 0)))
+    {
+        const int32_t n = watch_profile_find(argv[2]);
+        if (n < 0)
+        {
+            printf("error: no such profile\n");
+            return;
+        }
+        if (strcmp(argv[1], "load") == 0)
+        {
+            watch_profile_load(&config.cfg.watch[n]);
+            config.cfg.watch_profile = n;
+        }
+        else
+        {
+            memset(&config.cfg.watch[n], 0, sizeof(config.cfg.watch[n]));
+        }
+        config_save_slow();
+    }
+    else if (argc > 1)
+    {
+        printf("wprof [load name|del name]\n");
+        return;
+    }
+
+    for (int32_t i = 0; i < WATCH_PROFILE_NUM; i++)
+    {
+        const watch_profile_t *profile = &config.cfg.watch[i];
+        uint32_t size = 0;
+        if (profile->name[0] == '\0')
+        {
+            continue;
+        }
+        for (uint32_t j = 0; j < profile->count; j++)
+        {
+            size += profile->range[j][1] - profile->range[j][0] + 1;
+        }
+        printf("%c %-11s %3d ranges %5d addresses\n",
+               (i == config.cfg.watch_profile) ? '*' : ' ', profile->name, profile->count, size);
+    }
+}
+
+// bytes read from the CDC FIFO at once for XMODEM
+static uint8_t inbyte_buffer[CFG_TUD_CDC_RX_BUFSIZE];
+static uint32_t inbyte_pos = 0;
+static uint32_t inbyte_len = 0;
+
+static void inbyte_reset(void)
+{
+    inbyte_pos = 0;
+    inbyte_len = 0;
+}
+
+int _inbyte(unsigned short timeout)
+{
+    const uint32_t start = time_us_32();
+
+    if (inbyte_pos < inbyte_len)
+    {
+        return inbyte_buffer[inbyte_pos++];
+    }
+    do
+    {
+        binport_task();
+        inbyte_len = cdc_read(CAPBIN_ITF_CONSOLE, inbyte_buffer, sizeof(inbyte_buffer));
+        inbyte_pos = 0;
+        if (inbyte_len > 0)
+        {
+            return inbyte_buffer[inbyte_pos++];
+        }
+    } while (time_us_32() - start < (uint32_t)timeout * 1000);
+
+    return -1;
+}
+
+void _outbyte(int c)
+{
+    putchar_raw(c);
+}
+
+// XMODEM CRC, or YMODEM-G streaming without ACK for each block
+// returns false (reported) if the transfer did not complete
+static bool xmodem_receive(uint8_t *dest, bool stream)
+{
+    int32_t ret;
+
+    inbyte_reset();
+    if (stream)
+    {
+        ret = YmodemReceive(NULL, dest, sizeof(rom), 2);
+    }
+    else
+    {
+        ret = XmodemReceiveCrc(NULL, dest, sizeof(rom));
+    }
+    sleep_ms(1000);
+    if (ret <= 0)
+    {
+        // -1: canceled, -2: no sync, -3: too many retries, 0: no file
+        printf("error: receive failed (%d), image is incomplete\n", ret);
+        return false;
+    }
+    return true;
+}
+
+static void cmd_recv(int argc, const char *const *argv)
+{
+    const bool stream = (argc > 1) && (strcmp(argv[1], "g") == 0);
+
+    printf("receive data from host to device (%s)\n", stream ? "YMODEM-G" : "XMODEM CRC");
+    if (!xmodem_receive(device, stream))
+    {
+        return;
+    }
+    send_size = sizeof(rom);
+    printf("done.\n");
+}
+
+static void cmd_send(int argc, const char *const *argv)
+{
+    uint32_t size = send_size;
+    if (argc > 1)
+    {
+        size = strtol(argv[1], NULL, 16);
+        if ((size == 0) || (size > sizeof(rom)))
+        {
+            size = sizeof(rom);
+        }
+    }
+    printf("send data from device to host (XMODEM 1K, %d bytes)\n", size);
+    XmodemTransmit1K(NULL, device, size);
+    sleep_ms(1000);
+    printf("done.\n");
+}
+
+static void cmd_sum(int argc, const char *const *argv)
+{
+    const uint8_t *mem = device;
+    int32_t bank = -1;
+    uint32_t start = 0x0000;
+    uint32_t end = 0xffff;
+    uint32_t crc32, crc16, sum;
+
+    if ((argc > 2) && (strcmp(argv[1], "bank") == 0))
+    {
+        char *e;
+        bank = strtol(argv[2], &e, 10);
+        if ((*e != '\0') || !((bank >= 0) && (bank < ROM_BANK_NUM)))
+        {
+            printf("error: illegal bank num\n");
+            return;
+        }
+        mem = flash_target_contents_rom[bank];
+        argc -= 2;
+        argv += 2;
+    }
+    if (argc > 2)
+    {
+        start = strtol(argv[1], NULL, 16) & 0xffff;
+        end = strtol(argv[2], NULL, 16) & 0xffff;
+    }
+    else if (argc > 1)
+    {
+        printf("sum [bank 0|1|2|3] [start end]\n");
+        return;
+    }
+    if (start > end)
+    {
+        printf("error: illegal range\n");
+        return;
+    }
+
+    if (bank >= 0)
+    {
+        // same as load: do not read the flash at the overclocked speed
+        set_sys_clock_khz(CPU_CLOCK_FREQ_NORMAL, true);
+        sleep_ms(FLASH_WAIT_MS);
+    }
+    // CRC-32 (IEEE 802.3), CRC-16-CCITT (init 0xffff), byte sum
+    crc32 = dma_sniff(&mem[start], end - start + 1, DMA_SNIFF_CTRL_CALC_VALUE_CRC32R, 0xffffffff, true);
+    crc16 = dma_sniff(&mem[start], end - start + 1, DMA_SNIFF_CTRL_CALC_VALUE_CRC16, 0xffff, false);
+    sum = dma_sniff(&mem[start], end - start + 1, DMA_SNIFF_CTRL_CALC_VALUE_SUM, 0, false);
+    if (bank >= 0)
+    {
+        sleep_ms(FLASH_WAIT_MS);
+        set_sys_clock_khz(CPU_CLOCK_FREQ_HIGH, true);
+        printf("bank %d %04x-%04x\n", bank, start, end);
+    }
+    else
+    {
+        printf("device %04x-%04x\n", start, end);
+    }
+    printf(" crc32 : %08x\n", crc32);
+    printf(" crc16 : %04x\n", crc16 & 0xffff);
+    printf(" sum8  : %02x\n", sum & 0xff);
+    printf(" sum16 : %04x\n", sum & 0xffff);
+}
+
+static void cmd_bank(int argc, const char *const *argv)
+{
+    if (argc > 1)
+    {
+        int32_t bank = -1;
+        char *end;
+        bank = strtol(argv[1], &end, 10);
+        if ((*end == '\0') && (bank >= 0) && (bank <= 3))
+        {
+            config.cfg.rom_bank = bank;
+            config_save_slow();
+
+            printf("current rom bank: %d\n", config.cfg.rom_bank);
+            return;
+        }
+        else
+        {
+            printf("error: illegal bank num\n");
+        }
+    }
+
+    printf("bank 0|1|2|3\n");
+    printf("current rom bank: %d\n", config.cfg.rom_bank);
+}
+
+static void cmd_load(int argc, const char *const *argv)
+{
+    bool ret;
+
+    int32_t bank = config.cfg.rom_bank;
+
+    printf("load rom bank %d ... ", bank);
+    ret = rom_load_slow(rom_active(), bank);
+    send_size = sizeof(rom);
+    printf("done.\n");
+
+    if (ret)
+    {
+        printf("load: OK\n");
+    }
+    else
+    {
+        printf("load: NG\n");
+    }
+}
+
+static void cmd_save(int argc, const char *const *argv)
+{
+    bool ret;
+    int32_t bank = config.cfg.rom_bank;
+
+    printf("save rom bank %d ... ", bank);
+    ret = rom_save_slow(rom_active(), bank);
+    printf("done.\n");
+
+    if (ret)
+    {
+        printf("save: OK\n");
+    }
+    else
+    {
+        printf("save: NG\n");
+    }
+}
+
+static bool swap_wr_stopped = false;
+static bool swap_shadow_incomplete = false;     // recv into the shadow failed
+
+static uint8_t *swap_image(uint32_t slot)
+{
+    return (slot == 0) ? rom : ram;
+}
+
+static void swap_status(void)
+{
+    const uint32_t slot = romemu_selected();
+    printf("active: %s, shadow: %s%s\n", (slot == 0) ? "rom" : "ram", (slot == 0) ? "ram" : "rom",
+           swap_shadow_incomplete ? " (incomplete)" : "");
+}
+
+static void cmd_swap(int argc, const char *const *argv)
+{
+    if (config.cfg.mode != CONFIG_MODE_EMULATOR)
+    {
+        printf("error: only available in emulator mode\n");
+        return;
+    }
+    if (config.cfg.ext_bank_pin != 0)
+    {
+        printf("error: image is selected by ext%d (extbank)\n", config.cfg.ext_bank_pin - 1);
+        return;
+    }
+    if ((argc > 1) && (strcmp(argv[1], "status") == 0))
+    {
+        swap_status();
+        return;
+    }
+
+    // ram is the second image slot, stop the write capture into it
+    if (!swap_wr_stopped)
+    {
+        busmon_wr_stop();
+        swap_wr_stopped = true;
+        printf("write capture to ram is stopped until reboot\n");
+    }
+
+    uint8_t *shadow = swap_image(romemu_selected() ^ 1);
+    if (argc > 1)
+    {
+        if (strcmp(argv[1], "load") == 0)
+        {
+            int32_t bank = config.cfg.rom_bank;
+            if (argc > 2)
+            {
+                char *end;
+                bank = strtol(argv[2], &end, 10);
+                if (!((*end == '\0') && (bank >= 0) && (bank < ROM_BANK_NUM)))
+                {
+                    printf("error: illegal bank num\n");
+                    return;
+                }
+            }
+            printf("load rom bank %d to shadow ... ", bank);
+            rom_load_slow(shadow, bank);
+            swap_shadow_incomplete = false;
+            printf("done.\n");
+        }
+        else if (strcmp(argv[1], "recv") == 0)
+        {
+            const bool stream = (argc > 2) && (strcmp(argv[2], "g") == 0);
+
+            printf("receive data from host to shadow (%s)\n", stream ? "YMODEM-G" : "XMODEM CRC");
+            swap_shadow_incomplete = !xmodem_receive(shadow, stream);
+            if (!swap_shadow_incomplete)
+            {
+                printf("done.\n");
+            }
+        }
+        else
+        {
+            printf("swap [load [0|1|2|3]|recv [g]|status]\n");
+        }
+        return;
+    }
+
+    if (swap_shadow_incomplete)
+    {
+        printf("error: shadow image is incomplete (swap load or swap recv again)\n");
+        return;
+    }
+    romemu_select(romemu_selected() ^ 1);
+    swap_status();
+}
+
+static bool erase_rom_bank(int32_t bank)
+{
+    bool ret;
+
+    printf("erase rom bank %d ... ", bank);
+    ret = rom_erase_slow(bank);
+    printf("done.\n");
+
+    return ret;
+}
+
+static void cmd_erase(int argc, const char *const *argv)
+{
+    bool ret;
+    int32_t bank;
+
+    if (argc > 1)
+    {
+        char *end;
+        bank = strtol(argv[1], &end, 10);
+        if ((*end != '\0') || !((bank >= 0) && (bank <= 3)))
+        {
+            printf("error: illegal bank num\n");
+            return;
+        }
+    }
+    else
+    {
+        // for safety
+        //bank = config.cfg.rom_bank;
+        printf("erase 0|1|2|3\n");
+        return;
+    }
+
+    ret = erase_rom_bank(bank);
+
+    if (ret)
+    {
+        printf("erase: OK\n");
+    }
+    else
+    {
+        printf("erase: NG\n");
+    }
+}
+
+static int32_t clone_vote_pass = 0;
+static int32_t clone_vote_num = 0;
+static int32_t clone_vote_overflow = 0;
+static int32_t clone_unstable_num = 0;
+
+static inline uint32_t vote_spread(uint8_t value)
+{
+    uint32_t ones = 0;
+    for (int32_t b = 0; b < 8; b++)
+    {
+        ones |= (uint32_t)((value >> b) & 1) << (b * 4);
+    }
+    return ones;
+}
+
+static inline uint32_t vote_count(uint32_t ones, int32_t bn)
+{
+    return (ones >> (bn * 4)) & 0x0f;
+}
+
+static inline bool clone_is_unstable(uint32_t addr)
+{
+    return (work_area.clone.unstable[addr / 8] & (1 << (addr % 8))) != 0;
+}
+
+static void clone_vote_start(void)
+{
+    zero_clear(work_area.clone.unstable, sizeof(work_area.clone.unstable));
+    clone_vote_pass = 1; // rom holds the first pass
+    clone_vote_num = 0;
+    clone_vote_overflow = 0;
+    clone_unstable_num = 0;
+}
+
+// fold one more pass (in ram) into the vote against the first pass (in rom)
+static int32_t clone_vote_add(void)
+{
+    const uint32_t *ref = (const uint32_t *)rom;
+    const uint32_t *cur = (const uint32_t *)ram;
+    const int32_t known = clone_vote_num;
+    int32_t new_unstable = 0;
+
+    // bytes already known to be unstable take every pass
+    for (int32_t i = 0; i < known; i++)
+    {
+        clone_vote_t *v = &work_area.clone.vote[i];
+        v->ones += vote_spread(ram[v->addr]);
+    }
+
+    for (uint32_t i = 0; i < sizeof(rom) / sizeof(uint32_t); i++)
+    {
+        uint32_t diff = ref[i] ^ cur[i];
+        while (diff != 0)
+        {
+            const uint32_t shift = __builtin_ctz(diff) & ~7u;
+            const uint32_t addr = i * sizeof(uint32_t) + shift / 8;
+            diff &= ~(0xffu << shift);
+
+            if (clone_is_unstable(addr))
+            {
+                continue;
+            }
+            work_area.clone.unstable[addr / 8] |= (1 << (addr % 8));
+            clone_unstable_num++;
+            new_unstable++;
+
+            if (clone_vote_num < CLONE_VOTE_COUNT)
+            {
+                // every earlier pass agreed with the first one
+                clone_vote_t *v = &work_area.clone.vote[clone_vote_num++];
+                v->addr = addr;
+                v->ones = vote_spread(rom[addr]) * clone_vote_pass + vote_spread(ram[addr]);
+            }
+            else
+            {
+                clone_vote_overflow++;
+            }
+        }
+    }
+    clone_vote_pass++;
+
+    return new_unstable;
+}
+
+// replace unstable bytes in rom with the bit-wise majority (ties keep the first pass)
+static void clone_vote_finish(void)
+{
+    for (int32_t i = 0; i < clone_vote_num; i++)
+    {
+        const clone_vote_t *v = &work_area.clone.vote[i];
+        uint8_t value = rom[v->addr];
+        for (int32_t b = 0; b < 8; b++)
+        {
+            const uint32_t ones = vote_count(v->ones, b);
+            if (ones * 2 > clone_vote_pass)
+            {
+                value |= (1 << b);
+            }
+            else if (ones * 2 < clone_vote_pass)
+            {
+                value &= ~(1 << b);
+            }
+        }
+        rom[v->addr] = value;
+    }
+}
+
+static uint32_t clone_vote_agreement(const clone_vote_t *v)
+{
+    uint32_t agree = clone_vote_pass;
+    for (int32_t b = 0; b < 8; b++)
     {
-        if (capture_rp != capture_wp)
+        uint32_t ones = vote_count(v->ones, b);
+        uint32_t n = (ones * 2 >= clone_vote_pass) ? ones : (clone_vote_pass - ones);
+        if (n < agree)
         {
-            cap = capture_buffer[capture_rp];
-            addr = cap & 0xffff;
-            data = (cap >> 16) & 0xff;
-            rw = cap >> (16 + 8 + 3 + 1);
-            capture_rp = (capture_rp + 1) % CAPTURE_COUNT;
-
-            printf("%c:%04x:%02x\n", str_rw[rw], addr, data);
+            agree = n;
         }
     }
+    return agree;
 }
 
-static void cmd_list_watch(int argc, const char *const *argv)
+static const struct
 {
-    uint32_t start = 0x0000;
-    uint32_t end = 0xffff;
-    uint32_t addr;
-    bool watch = false;
-    const char *format = "%04x %04x\n";
+    uint32_t size;
+    const char *name;
+} rom_chip_table[] =
+{
+    {0x10000,   "27C512"},
+    {0x8000,    "27C256"},
+    {0x4000,    "27C128"},
+    {0x2000,    "27C64"},
+    {0x1000,    "2732"},
+    {0x0800,    "2716"},
+    {0,         NULL}
+};
 
-    if (argc > 1)
-    {
-        start = strtol(argv[1], NULL, 16) & 0xffff;
-    }
-    if (argc > 2)
-    {
-        end = strtol(argv[2], NULL, 16) & 0xffff;
-    }
+// true if toggling the address line never changes the data (mirrored, stuck or open)
+static bool addr_line_has_no_effect(const uint8_t *mem, int32_t line)
+{
+    const uint32_t *w = (const uint32_t *)mem;
+    const uint32_t count = 0x10000 / sizeof(uint32_t);
 
-    for (addr = start; addr <= end; addr++)
+    if (line == 0)
     {
-        if (!watch)
+        for (uint32_t i = 0; i < count; i++)
         {
-            if (capture_is_target(addr))
+            if (((w[i] >> 8) ^ w[i]) & 0x00ff00ff)
             {
-                watch = true;
-                start = addr;
+                return false;
             }
         }
-        else
+    }
+    else if (line == 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
         {
-            if (!capture_is_target(addr))
+            if (((w[i] >> 16) ^ w[i]) & 0x0000ffff)
             {
-                watch = false;
-                printf(format, start, addr - 1);
+                return false;
             }
         }
     }
-    if (watch)
+    else
     {
-        printf(format, start, addr - 1);
+        const uint32_t stride = 1 << (line - 2);
+        for (uint32_t base = 0; base < count; base += stride * 2)
+        {
+            for (uint32_t i = base; i < base + stride; i++)
+            {
+                if (w[i] != w[i + stride])
+                {
+                    return false;
+                }
+            }
+        }
     }
+    return true;
 }
 
-static void cmd_save_watch(int argc, const char *const *argv)
-{
-    printf("save capture area ... ");
-    memcpy(config.cfg.capture_target, capture_target, sizeof(capture_target));
-    config_save_slow();
-    printf("done.\n");
-}
-
-int _inbyte(unsigned short timeout)
-{
-    return getchar_timeout_us((uint32_t)timeout * 1000);
-}
-
-void _outbyte(int c)
+// report mirrored/dead address lines and return the detected chip size
+static uint32_t detect_chip_size(const uint8_t *mem)
 {
-    putchar_raw(c);
-}
+    uint32_t no_effect = 0;
+    uint32_t size = 0x10000;
+    const char *name = "unknown";
 
-static void cmd_recv(int argc, const char *const *argv)
-{
-    printf("receive data from host to device (XMODEM CRC)\n");
-    XmodemReceiveCrc(NULL, device, sizeof(rom));
-    sleep_ms(1000);
-    printf("done.\n");
-}
+    for (int32_t line = 0; line < GPIO_ADDR_END - GPIO_ADDR; line++)
+    {
+        if (addr_line_has_no_effect(mem, line))
+        {
+            no_effect |= bit(line);
+        }
+    }
 
-static void cmd_send(int argc, const char *const *argv)
-{
-    printf("send data from device to host (XMODEM 1K)\n");
-    XmodemTransmit1K(NULL, device, sizeof(rom));
-    sleep_ms(1000);
-    printf("done.\n");
-}
+    if (no_effect == 0xffff)
+    {
+        printf("address lines: no effect at all, image is filled with %02x (no chip?)\n", mem[0]);
+        return sizeof(rom);
+    }
 
-static void cmd_bank(int argc, const char *const *argv)
-{
-    if (argc > 1)
+    // the chip ends where the upper address lines stop making a difference
+    while ((size > rom_chip_table[ARRAY_SIZE(rom_chip_table) - 2].size) && btst(no_effect, __builtin_ctz(size) - 1))
     {
-        int32_t bank = -1;
-        char *end;
-        bank = strtol(argv[1], &end, 10);
-        if ((*end == '\0') && (bank >= 0) && (bank <= 3))
+        size /= 2;
+    }
+    for (int32_t i = 0; rom_chip_table[i].name != NULL; i++)
+    {
+        if (rom_chip_table[i].size == size)
         {
-            config.cfg.rom_bank = bank;
-            config_save_slow();
+            name = rom_chip_table[i].name;
+        }
+    }
 
-            printf("current rom bank: %d\n", config.cfg.rom_bank);
-            return;
+    printf("address lines:");
+    if (no_effect == 0)
+    {
+        printf(" all effective");
+    }
+    for (int32_t line = 0; line < GPIO_ADDR_END - GPIO_ADDR; line++)
+    {
+        if (btst(no_effect, line))
+        {
+            printf(" a%d", line);
         }
-        else
+    }
+    printf("%s\n", no_effect ? " without effect" : "");
+    for (int32_t line = 0; bit(line) < size; line++)
+    {
+        if (btst(no_effect, line))
         {
-            printf("error: illegal bank num\n");
+            printf("warning: a%d has no effect inside the chip (stuck or open address line?)\n", line);
         }
     }
+    printf("size: %d KiB (%s), mirrored x%d\n", size / 1024, name, sizeof(rom) / size);
 
-    printf("bank 0|1|2|3\n");
-    printf("current rom bank: %d\n", config.cfg.rom_bank);
+    return size;
 }
 
-static void cmd_load(int argc, const char *const *argv)
+static void print_margin(const char *name, int32_t bn, int32_t fail_delay, int32_t last_delay)
 {
-    bool ret;
-
-    int32_t bank = config.cfg.rom_bank;
-
-    printf("load rom bank %d ... ", bank);
-    ret = rom_load_slow(bank);
-    printf("done.\n");
+    char label[8];
 
-    if (ret)
+    if (bn >= 0)
     {
-        printf("load: OK\n");
+        snprintf(label, sizeof(label), "%s%d", name, bn);
     }
     else
     {
-        printf("load: NG\n");
+        snprintf(label, sizeof(label), "%s", name);
     }
-}
-
-static void cmd_save(int argc, const char *const *argv)
-{
-    bool ret;
-    int32_t bank = config.cfg.rom_bank;
-
-    printf("save rom bank %d ... ", bank);
-    ret = rom_save_slow(bank);
-    printf("done.\n");
 
-    if (ret)
+    if (fail_delay >= 0)
     {
-        printf("save: OK\n");
+        printf("  %-4s: %4d ns\n", label, romread_delay_to_ns(fail_delay + 1));
     }
     else
     {
-        printf("save: NG\n");
+        // never failed in the tested range
+        printf("  %-4s: %4d ns or less\n", label, romread_delay_to_ns(last_delay));
     }
 }
 
-static bool erase_rom_bank(int32_t bank)
+// the address line that had not settled yet: the failing bits read as the
+// reference of the address with that line still at its previous level
+static uint32_t clone_margin_slow_lines(uint32_t addr, uint8_t data, uint32_t fail)
 {
-    bool ret;
-
-    printf("erase rom bank %d ... ", bank);
-    ret = rom_erase_slow(bank);
-    printf("done.\n");
+    const uint32_t changed = addr ^ ((addr - 1) & 0xffff);
+    uint32_t found = 0;
 
-    return ret;
+    for (uint32_t b = 0; b < GPIO_ADDR_END - GPIO_ADDR; b++)
+    {
+        if (btst(changed, b) && (((rom[addr ^ bit(b)] ^ data) & fail) == 0))
+        {
+            if (found != 0)
+            {
+                // ambiguous
+                return 0;
+            }
+            found = bit(b);
+        }
+    }
+    return found;
 }
 
-static void cmd_erase(int argc, const char *const *argv)
+static void clone_margin(int argc, const char *const *argv)
 {
-    bool ret;
-    int32_t bank;
+    uint32_t wait_s = DEFAULT_CLONE_WAIT_S;
+    uint32_t access_ns = DEFAULT_CLONE_ACCESS_NS;
+    uint32_t ref_delay;
+    int32_t addr_fail[GPIO_ADDR_END - GPIO_ADDR];
+    int32_t data_fail[GPIO_DATA_END - GPIO_DATA];
+    int32_t chip_fail = -1;
+    int32_t last_delay;
 
     if (argc > 1)
     {
-        char *end;
-        bank = strtol(argv[1], &end, 10);
-        if ((*end != '\0') || !((bank >= 0) && (bank <= 3)))
-        {
-            printf("error: illegal bank num\n");
-            return;
-        }
+        wait_s = strtol(argv[1], NULL, 10);
     }
-    else
+    if (argc > 2)
     {
-        // for safety
-        //bank = config.cfg.rom_bank;
-        printf("erase 0|1|2|3\n");
+        access_ns = strtol(argv[2], NULL, 10);
+    }
+    ref_delay = romread_ns_to_delay(access_ns);
+
+    for (int32_t b = 0; b < ARRAY_SIZE(addr_fail); b++)
+    {
+        addr_fail[b] = -1;
+    }
+    for (int32_t b = 0; b < ARRAY_SIZE(data_fail); b++)
+    {
+        data_fail[b] = -1;
+    }
+
+    printf("access time margin\n");
+    printf(" wait     : %d s\n", wait_s);
+    printf(" reference: %d ns\n", romread_delay_to_ns(ref_delay));
+
+    sleep_ms(wait_s * 1000);
+
+    clone_vote_pass = 0;
+
+    printf("read reference ... ");
+    read_rom(rom, 0x0000, 0x10000, ref_delay);
+    read_rom(ram, 0x0000, 0x10000, ref_delay);
+    if (memcmp(rom, ram, sizeof(rom)) != 0)
+    {
+        printf("NG\n");
+        dump_diff(rom, ram, 0x10000, 16);
+        printf("margin: reference read is unstable\n");
         return;
     }
+    printf("OK\n");
 
-    ret = erase_rom_bank(bank);
+    // sweep the sample delay down by one PIO cycle per pass
+    last_delay = ref_delay;
+    for (int32_t delay = (int32_t)ref_delay - 1; delay >= 0; delay--)
+    {
+        const uint32_t *ref = (const uint32_t *)rom;
+        const uint32_t *cur = (const uint32_t *)ram;
+        uint32_t fail_count = 0;
+        uint32_t unknown_count = 0;
+        uint32_t addr_bits = 0;
+        uint32_t data_bits = 0;
+
+        read_rom(ram, 0x0000, 0x10000, delay);
+        last_delay = delay;
+        for (uint32_t i = 0; i < sizeof(rom) / sizeof(uint32_t); i++)
+        {
+            uint32_t diff = ref[i] ^ cur[i];
+            while (diff != 0)
+            {
+                const uint32_t shift = __builtin_ctz(diff) & ~7u;
+                const uint32_t addr = i * sizeof(uint32_t) + shift / 8;
+                const uint32_t fail = (diff >> shift) & 0xff;
+                const uint32_t bits = clone_margin_slow_lines(addr, ram[addr], fail);
+                if (bits != 0)
+                {
+                    addr_bits |= bits;
+                }
+                else
+                {
+                    unknown_count++;
+                }
+                data_bits |= fail;
+                diff &= ~(0xffu << shift);
+                fail_count++;
+            }
+        }
 
-    if (ret)
+        printf(" %4d ns: ", romread_delay_to_ns(delay));
+        if (fail_count == 0)
+        {
+            printf("OK\n");
+            continue;
+        }
+        printf("NG %d byte(s) A:%04x D:%02x (%d not explained by one address line)\n",
+               fail_count, addr_bits, data_bits, unknown_count);
+
+        if (chip_fail < 0)
+        {
+            chip_fail = delay;
+        }
+        for (int32_t b = 0; b < ARRAY_SIZE(addr_fail); b++)
+        {
+            if ((addr_fail[b] < 0) && btst(addr_bits, b))
+            {
+                addr_fail[b] = delay;
+            }
+        }
+        for (int32_t b = 0; b < ARRAY_SIZE(data_fail); b++)
+        {
+            if ((data_fail[b] < 0) && btst(data_bits, b))
+            {
+                data_fail[b] = delay;
+            }
+        }
+        if (data_bits == 0xff)
+        {
+            // every data bit is failing, shorter timing tells nothing new
+            break;
+        }
+    }
+
+    // shortest passing timing = one step above the first failure
+    printf("address bit margin:\n");
+    for (int32_t b = 0; b < ARRAY_SIZE(addr_fail); b++)
     {
-        printf("erase: OK\n");
+        print_margin("a", b, addr_fail[b], last_delay);
     }
-    else
+    printf("data bit margin:\n");
+    for (int32_t b = 0; b < ARRAY_SIZE(data_fail); b++)
     {
-        printf("erase: NG\n");
+        print_margin("d", b, data_fail[b], last_delay);
     }
+    print_margin("chip", -1, chip_fail, last_delay);
 }
 
 static void cmd_clone(int argc, const char *const *argv)
 {
-    bool clone_ok = true;
     uint32_t wait_s = DEFAULT_CLONE_WAIT_S;
     int32_t verify_num = DEFAULT_CLONE_VERIFY_NUM;
+    uint32_t access_ns = DEFAULT_CLONE_ACCESS_NS;
+    uint32_t delay;
+
+    if ((argc > 1) && (strcmp(argv[1], "margin") == 0))
+    {
+        clone_margin(argc - 1, argv + 1);
+        return;
+    }
 
     if (argc > 1)
     {
@@ -1239,34 +4463,92 @@ static void cmd_clone(int argc, const char *const *argv)
     if (argc > 2)
     {
         verify_num = strtol(argv[2], NULL, 10);
+        if (verify_num > CLONE_VOTE_MAX_PASS - 1)
+        {
+            verify_num = CLONE_VOTE_MAX_PASS - 1;
+        }
+    }
+    if (argc > 3)
+    {
+        access_ns = strtol(argv[3], NULL, 10);
     }
+    delay = romread_ns_to_delay(access_ns);
 
     printf("read ROM\n");
     printf(" wait  : %d s\n", wait_s);
     printf(" verify: %d times\n", verify_num);
+    printf(" access: %d ns\n", romread_delay_to_ns(delay));
 
     sleep_ms(wait_s * 1000);
 
     printf("read start ... ");
-    read_rom(rom, 0x0000, 0x10000);
+    read_rom(rom, 0x0000, 0x10000, delay);
     printf("done.\n");
 
+    clone_vote_start();
     for (int32_t i = 0; i < verify_num; i++)
     {
         printf("verify (%d/%d) ... ", i + 1, verify_num);
-        read_rom(ram, 0x0000, 0x10000);
+        read_rom(ram, 0x0000, 0x10000, delay);
         if (memcmp(rom, ram, sizeof(rom)) == 0)
         {
+            clone_vote_add();
             printf("OK\n");
         }
         else
         {
             printf("NG\n");
             dump_diff(rom, ram, 0x10000, 16);
-            clone_ok = false;
+            printf(" %d new unstable byte(s)\n", clone_vote_add());
+        }
+    }
+    clone_vote_finish();
+
+    send_size = detect_chip_size(rom);
+
+    if (clone_unstable_num == 0)
+    {
+        printf("clone: OK\n");
+    }
+    else
+    {
+        printf("unstable: %d byte(s), majority of %d passes applied\n", clone_unstable_num, clone_vote_pass);
+        if (clone_vote_overflow > 0)
+        {
+            printf("warning: vote table full, %d byte(s) keep the first read\n", clone_vote_overflow);
         }
+        printf("clone: NG (see umap)\n");
+    }
+}
+
+static void cmd_unstable_map(int argc, const char *const *argv)
+{
+    if (clone_vote_pass == 0)
+    {
+        printf("no clone result\n");
+        return;
+    }
+
+    if ((argc > 1) && (strcmp(argv[1], "send") == 0))
+    {
+        printf("send unstable bitmap to host (XMODEM 1K)\n");
+        XmodemTransmit1K(NULL, work_area.clone.unstable, sizeof(work_area.clone.unstable));
+        sleep_ms(1000);
+        printf("done.\n");
+        return;
+    }
+
+    // addr: majority value, agreement of the weakest bit
+    for (int32_t i = 0; i < clone_vote_num; i++)
+    {
+        const clone_vote_t *v = &work_area.clone.vote[i];
+        printf("%04x %02x %d/%d\n", v->addr, rom[v->addr], clone_vote_agreement(v), clone_vote_pass);
     }
-    printf("clone: %s\n", clone_ok ? "OK" : "NG");
+    if (clone_vote_overflow > 0)
+    {
+        printf("(%d more byte(s) not voted)\n", clone_vote_overflow);
+    }
+    printf("%d unstable byte(s) in %d passes\n", clone_unstable_num, clone_vote_pass);
 }
 
 static void cmd_init(int argc, const char *const *argv)
@@ -1339,7 +4621,7 @@ static const command_table_t command_table_emulator[] =
     {"cls",     cmd_cls,        "clear screen"},
 
     {"reboot",  cmd_reboot,     "reboot RP27C512 (reboot delay)"},
-    {"mode",    cmd_mode,       "select mode (mode emulator|snoop|clone)"},
+    {"mode",    cmd_mode,       "select mode (mode emulator|snoop|clone|sram)"},
     {"bootsel", cmd_bootsel,    "reboot RP27C512 in BOOTSEL mode (bootsel delay)"},
     {"gpio",    cmd_gpio,       "control GPIO (gpio help)"},
 
@@ -1354,18 +4636,35 @@ static const command_table_t command_table_emulator[] =
 
     {"watch",   cmd_watch,      "set capture area (watch start end)"},
     {"unwatch", cmd_unwatch,    "unset capture area (unwatch start end)"},
-    {"cap",     cmd_capture,    "show capture log"},
+    {"cap",     cmd_capture,    "show capture log (cap [seq])"},
+    {"capbin",  cmd_capture_binary, "stream capture log in binary (tools/capdecode.py)"},
+    {"trace",   cmd_trace,      "show instruction trace (trace [6502|z80|6809 [org]])"},
+    {"trig",    cmd_trigger,    "trigger capture (trig help)"},
     {"wlist",   cmd_list_watch, "list capture area (wlist [start [end]])"},
-    {"wsave",   cmd_save_watch, "save capture area"},
-
-    {"recv",    cmd_recv,       "receive data from host (XMODEM CRC)"},
-    {"send",    cmd_send,       "send data to host (XMODEM 1K)"},
+    {"wop",     cmd_watch_op,   "edit capture area (wop clear|all|inv [start end]|and start end|load)"},
+    {"wsave",   cmd_save_watch, "save capture area as profile (wsave [name])"},
+    {"wprof",   cmd_watch_profile, "list/load/delete capture area profiles (wprof [load name|del name])"},
+    {"capstat", cmd_capture_stat, "show capture statistics (overflow, lost)"},
+    {"capfilt", cmd_capture_filter, "filter capture by address block in PIO (capfilt off|start end)"},
+    {"cov",     cmd_coverage,   "show read/write coverage of capmode cov (cov [read|write] [start end]|clear|send)"},
+    {"hot",     cmd_hot,        "show most read blocks of capmode cov (hot [n])"},
+    {"prof",    cmd_prof,       "sampling profiler of read addresses (prof help)"},
+    {"edges",   cmd_edges,      "control-flow edges and basic blocks of reads (edges help)"},
+    {"capmode", cmd_capture_mode, "select capture buffer (capmode normal|deep [ts] [rle]|cov)"},
+
+    {"recv",    cmd_recv,       "receive data from host (XMODEM CRC, recv g: YMODEM-G)"},
+    {"send",    cmd_send,       "send data to host (XMODEM 1K) (send [size])"},
+    {"sum",     cmd_sum,        "checksum of device or flash rom bank (sum [bank n] [start end])"},
 
     {"bank",    cmd_bank,       "select flash rom bank (bank 0|1|2|3)"},
     {"load",    cmd_load,       "load data from current flash rom bank"},
     {"save",    cmd_save,       "save data to current flash rom bank"},
     {"erase",   cmd_erase,      "erase flash rom bank (erase 0|1|2|3)"},
 
+    {"fcmd",    cmd_fcmd,       "flash rom command emulation (fcmd off|29f|at29|28c|save)"},
+    {"wp",      cmd_wp,         "write protect range of sram mode (wp off|start end)"},
+    {"extbank", cmd_extbank,    "select image by ext pin (extbank off|0|1|2 [upper bank])"},
+    {"swap",    cmd_swap,       "stage/switch shadow rom image (swap [load [bank]|recv|status])"},
     {"init",    cmd_init,       "initialize rom/config (init all|rom|config)"},
 
     {NULL, NULL}
@@ -1380,7 +4679,7 @@ static const command_table_t command_table_clone[] =
     {"cls",     cmd_cls,        "clear screen"},
 
     {"reboot",  cmd_reboot,     "reboot RP27C512 (reboot delay)"},
-    {"mode",    cmd_mode,       "select mode (mode emulator|snoop|clone)"},
+    {"mode",    cmd_mode,       "select mode (mode emulator|snoop|clone|sram)"},
     {"bootsel", cmd_bootsel,    "reboot RP27C512 in BOOTSEL mode (bootsel delay)"},
     {"gpio",    cmd_gpio,       "control GPIO (gpio help)"},
 
@@ -1391,15 +4690,17 @@ static const command_table_t command_table_clone[] =
     {"m",       cmd_move,       "move memory (m start end dest)"},
     {"f",       cmd_fill,       "fill memory (f start end value)"},
 
-    {"recv",    cmd_recv,       "receive data from host (XMODEM CRC)"},
-    {"send",    cmd_send,       "send data to host (XMODEM 1K)"},
+    {"recv",    cmd_recv,       "receive data from host (XMODEM CRC, recv g: YMODEM-G)"},
+    {"send",    cmd_send,       "send data to host (XMODEM 1K) (send [size])"},
+    {"sum",     cmd_sum,        "checksum of device or flash rom bank (sum [bank n] [start end])"},
 
     {"bank",    cmd_bank,       "select flash rom bank (bank 0|1|2|3)"},
     {"load",    cmd_load,       "load data from current flash rom bank"},
     {"save",    cmd_save,       "save data to current flash rom bank"},
     {"erase",   cmd_erase,      "erase flash rom bank (erase 0|1|2|3)"},
 
-    {"clone",   cmd_clone,      "clone from real ROM chip (clone wait verify_num)"},
+    {"clone",   cmd_clone,      "clone from real ROM chip (clone wait verify_num access_ns|clone margin wait access_ns)"},
+    {"umap",    cmd_unstable_map, "list unstable bytes of last clone (umap [send])"},
 
     {"init",    cmd_init,       "initialize rom/config (init all|rom|config)"},
 
@@ -1483,6 +4784,7 @@ static void shell(void)
             char ch = (char)c;
             microrl_processing_input(&rl, &ch, 1);
         }
+        binport_task();
 
         if (!tud_cdc_connected())
             break;
@@ -1506,6 +4808,11 @@ int main(void)
     stdio_init_all();
 
     config_ok = config_load();
+    if (!config_ok && config_migrate())
+    {
+        config_save_init();
+        config_ok = true;
+    }
     if (!config_ok)
     {
         printf("configration is broken. initialize.\n");
@@ -1516,10 +4823,19 @@ int main(void)
     switch (config.cfg.mode)
     {
     case CONFIG_MODE_EMULATOR:
+    case CONFIG_MODE_SRAM:
         {
             int32_t ch = rom_load_async_start(config.cfg.rom_bank);
-            zero_clear(ram, sizeof(ram));
-            rom_load_async_wait(ch);
+            if ((config.cfg.mode == CONFIG_MODE_EMULATOR) && (config.cfg.ext_bank_pin != 0))
+            {
+                rom_load_async_wait(ch);
+                rom_load(ram, config.cfg.ext_bank_upper);
+            }
+            else
+            {
+                zero_clear(ram, sizeof(ram));
+                rom_load_async_wait(ch);
+            }
         }
         break;
     case CONFIG_MODE_SNOOP:
@@ -1581,14 +4897,74 @@ int main(void)
     {
     case CONFIG_MODE_EMULATOR:
     case CONFIG_MODE_SNOOP:
+    case CONFIG_MODE_SRAM:
         {
+            const int32_t ext_pin = (config.cfg.ext_bank_pin != 0) ? GPIO_EXT0 + config.cfg.ext_bank_pin - 1 : -1;
             if (config.cfg.mode == CONFIG_MODE_EMULATOR)
             {
-                romemu_init(pio0, 0, rom);
+                romemu_init(pio0, 0, rom, ext_pin);
+            }
+            if (config.cfg.capture_ts)
+            {
+                // records become pairs: bus condition, timestamp
+                busmon_cap_set_timestamp(true);
+                capture_record_words = 2;
+            }
+            if ((config.cfg.mode == CONFIG_MODE_EMULATOR) && (config.cfg.flash_emu_type > FLASH_EMU_OFF) && (config.cfg.capture_filter_size != 0))
+            {
+                // fcmd needs every write: filter in core1 after the flash command decoder
+                capture_filter_mask = 0x10000 - config.cfg.capture_filter_size;
+                capture_filter_block = config.cfg.capture_filter_start & capture_filter_mask;
+            }
+            else
+            {
+                // accesses outside of the block never reach the DMA buffer
+                busmon_cap_set_filter(config.cfg.capture_filter_start, config.cfg.capture_filter_size);
+                capture_filter_pio = (config.cfg.capture_filter_size != 0);
+            }
+            if (config.cfg.capture_cov)
+            {
+                // core1 updates coverage of all accesses in work_area
+                capture_cov = true;
+                memset(&work_area.cov, 0, sizeof(work_area.cov));
+            }
+            else if (config.cfg.capture_rle && !config.cfg.capture_deep)
+            {
+                // sequential reads are stored as run records by core1
+                capture_rle = true;
+            }
+            if (config.cfg.capture_deep)
+            {
+                // DMA writes all accesses into capture_buffer, filtered when read
+                capture_deep = true;
+                busmon_cap_set_buffer(work_area.capture_buffer, CAPTURE_COUNT);
+            }
+            if (config.cfg.mode == CONFIG_MODE_SRAM)
+            {
+                // read and write the same image
+                romemu_init(pio0, 0, rom, -1);
+                busmon_init_sram(pio1, pio0, 0, rom, config.cfg.sram_wp_start, config.cfg.sram_wp_size);
+            }
+            else
+            {
+                busmon_init(pio1, 0, ram);
+            }
+            if ((config.cfg.mode == CONFIG_MODE_EMULATOR) && (ext_pin >= 0))
+            {
+                // ram holds the upper image
+                busmon_wr_stop();
+                gpio_set_dir(ext_pin, false);
             }
-            busmon_init(pio1, 0, ram);
 
-            memcpy(capture_target, config.cfg.capture_target, sizeof(capture_target));
+            capture_target_update(0x0000, 0xffff, BITMAP_CLEAR);
+            if ((config.cfg.watch_profile >= 0) && (config.cfg.watch_profile < WATCH_PROFILE_NUM))
+            {
+                watch_profile_load(&config.cfg.watch[config.cfg.watch_profile]);
+            }
+            if ((config.cfg.mode == CONFIG_MODE_EMULATOR) && (config.cfg.flash_emu_type > FLASH_EMU_OFF) && (config.cfg.flash_emu_type < FLASH_EMU_NUM))
+            {
+                flash_emu_type = (flash_emu_type_e)config.cfg.flash_emu_type;
+            }
 
             command_table = command_table_emulator;
             multicore_launch_core1(core1_entry_emulator);
@@ -1612,6 +4988,8 @@ int main(void)
             gpio_pull_up(GPIO_OE);
             gpio_set_drive_strength(GPIO_OE, GPIO_DRIVE_STRENGTH_12MA);
 
+            romread_init(pio0, 0);
+
             command_table = command_table_clone;
             multicore_launch_core1(core1_entry_clone);
         }
@@ -1621,13 +4999,22 @@ int main(void)
     for (;;)
     {
         while (!tud_cdc_connected())
-            sleep_ms(100);
+            binport_task();
         sleep_ms(250);
 
         printf("\n");
         printf("connected.\n");
         printf("%s\n", MAGIC_STR);
+        if (config_watch_truncated)
+        {
+            printf("warning: VER1.00 watch area had more than %d ranges, profile \"default\" keeps the first %d\n",
+                   WATCH_RANGE_MAX, WATCH_RANGE_MAX);
+        }
         printf("rom bank: %d\n", config.cfg.rom_bank);
+        if ((config.cfg.mode == CONFIG_MODE_EMULATOR) && (config.cfg.ext_bank_pin != 0))
+        {
+            printf("extbank: ext%d, upper bank %d\n", config.cfg.ext_bank_pin - 1, config.cfg.ext_bank_upper);
+        }
         switch (config.cfg.mode)
         {
         case CONFIG_MODE_EMULATOR:
@@ -1639,6 +5026,14 @@ int main(void)
         case CONFIG_MODE_CLONE:
             printf("mode: clone\n");
             break;
+        case CONFIG_MODE_SRAM:
+            printf("mode: sram\n");
+            if (config.cfg.sram_wp_size != 0)
+            {
+                printf("write protect: %04x-%04x\n",
+                       config.cfg.sram_wp_start, config.cfg.sram_wp_start + config.cfg.sram_wp_size - 1);
+            }
+            break;
         default:
             printf("mode: unknown (%d)\n", config.cfg.mode);
             break;
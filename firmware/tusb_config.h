@@ -0,0 +1,27 @@
+/*
+ * Copyright (c) 2024 Hirokuni Yano
+ *
+ * Released under the MIT license.
+ * see https://opensource.org/licenses/MIT
+ */
+#ifndef TUSB_CONFIG_H__
+#define TUSB_CONFIG_H__
+
+// CDC 0: stdio console, CDC 1: binary protocol (binport)
+#define CFG_TUSB_RHPORT0_MODE   (OPT_MODE_DEVICE)
+#define CFG_TUSB_OS             OPT_OS_PICO
+
+#define CFG_TUD_ENDPOINT0_SIZE  64
+
+#define CFG_TUD_CDC             2
+#define CFG_TUD_MSC             0
+#define CFG_TUD_HID             0
+#define CFG_TUD_MIDI            0
+#define CFG_TUD_VENDOR          0
+
+// bulk images: larger FIFOs than the stdio default
+#define CFG_TUD_CDC_RX_BUFSIZE  512
+#define CFG_TUD_CDC_TX_BUFSIZE  512
+#define CFG_TUD_CDC_EP_BUFSIZE  64
+
+#endif
@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2024 Hirokuni Yano
+ *
+ * Released under the MIT license.
+ * see https://opensource.org/licenses/MIT
+ */
+#include "pico/unique_id.h"
+#include <stdint.h>
+#include <string.h>
+#include <tusb.h>
+
+// two CDC interfaces: console (stdio) and binport
+#define USBD_VID            (0x2E8A)    // Raspberry Pi
+#define USBD_PID            (0x000A)    // Raspberry Pi Pico SDK CDC
+// the SDK's single CDC device uses 0x0100: hosts caching the descriptors by
+// VID/PID/bcdDevice must not mistake the two-CDC layout for it
+#define USBD_BCD_DEVICE     (0x0200)
+
+#define USBD_ITF_CDC_0      (0)
+#define USBD_ITF_CDC_1      (2)
+#define USBD_ITF_MAX        (4)
+
+#define USBD_EP_CDC_0_CMD   (0x81)
+#define USBD_EP_CDC_0_OUT   (0x02)
+#define USBD_EP_CDC_0_IN    (0x82)
+#define USBD_EP_CDC_1_CMD   (0x83)
+#define USBD_EP_CDC_1_OUT   (0x04)
+#define USBD_EP_CDC_1_IN    (0x84)
+#define USBD_CDC_CMD_SIZE   (8)
+#define USBD_CDC_DATA_SIZE  (64)
+
+#define USBD_DESC_LEN       (TUD_CONFIG_DESC_LEN + TUD_CDC_DESC_LEN * 2)
+#define USBD_MAX_POWER_MA   (250)
+
+enum
+{
+    USBD_STR_LANGUAGE,
+    USBD_STR_MANUF,
+    USBD_STR_PRODUCT,
+    USBD_STR_SERIAL,
+    USBD_STR_CDC_0,
+    USBD_STR_CDC_1,
+    USBD_STR_NUM,
+};
+
+static const tusb_desc_device_t usbd_desc_device = {
+    .bLength = sizeof(tusb_desc_device_t),
+    .bDescriptorType = TUSB_DESC_DEVICE,
+    .bcdUSB = 0x0200,
+    // interface association
+    .bDeviceClass = TUSB_CLASS_MISC,
+    .bDeviceSubClass = MISC_SUBCLASS_COMMON,
+    .bDeviceProtocol = MISC_PROTOCOL_IAD,
+    .bMaxPacketSize0 = CFG_TUD_ENDPOINT0_SIZE,
+    .idVendor = USBD_VID,
+    .idProduct = USBD_PID,
+    .bcdDevice = USBD_BCD_DEVICE,
+    .iManufacturer = USBD_STR_MANUF,
+    .iProduct = USBD_STR_PRODUCT,
+    .iSerialNumber = USBD_STR_SERIAL,
+    .bNumConfigurations = 1,
+};
+
+static const uint8_t usbd_desc_cfg[USBD_DESC_LEN] = {
+    TUD_CONFIG_DESCRIPTOR(1, USBD_ITF_MAX, 0, USBD_DESC_LEN, 0, USBD_MAX_POWER_MA),
+    TUD_CDC_DESCRIPTOR(USBD_ITF_CDC_0, USBD_STR_CDC_0, USBD_EP_CDC_0_CMD, USBD_CDC_CMD_SIZE,
+                       USBD_EP_CDC_0_OUT, USBD_EP_CDC_0_IN, USBD_CDC_DATA_SIZE),
+    TUD_CDC_DESCRIPTOR(USBD_ITF_CDC_1, USBD_STR_CDC_1, USBD_EP_CDC_1_CMD, USBD_CDC_CMD_SIZE,
+                       USBD_EP_CDC_1_OUT, USBD_EP_CDC_1_IN, USBD_CDC_DATA_SIZE),
+};
+
+static char usbd_serial_str[PICO_UNIQUE_BOARD_ID_SIZE_BYTES * 2 + 1];
+
+static const char *const usbd_desc_str[USBD_STR_NUM] = {
+    [USBD_STR_MANUF] = "Raspberry Pi",
+    [USBD_STR_PRODUCT] = "RP27C512",
+    [USBD_STR_SERIAL] = usbd_serial_str,
+    [USBD_STR_CDC_0] = "RP27C512 console",
+    [USBD_STR_CDC_1] = "RP27C512 binport",
+};
+
+const uint8_t *tud_descriptor_device_cb(void)
+{
+    return (const uint8_t *)&usbd_desc_device;
+}
+
+const uint8_t *tud_descriptor_configuration_cb(uint8_t index)
+{
+    (void)index;
+    return usbd_desc_cfg;
+}
+
+const uint16_t *tud_descriptor_string_cb(uint8_t index, uint16_t langid)
+{
+    static uint16_t desc_str[32 + 1];
+    uint32_t len;
+
+    (void)langid;
+    if (usbd_serial_str[0] == '\0')
+    {
+        pico_get_unique_board_id_string(usbd_serial_str, sizeof(usbd_serial_str));
+    }
+    if (index == USBD_STR_LANGUAGE)
+    {
+        desc_str[1] = 0x0409;   // English
+        len = 1;
+    }
+    else
+    {
+        if (index >= USBD_STR_NUM)
+        {
+            return NULL;
+        }
+        const char *str = usbd_desc_str[index];
+        for (len = 0; (len < 32) && (str[len] != '\0'); len++)
+        {
+            desc_str[1 + len] = str[len];
+        }
+    }
+    // first element: length (bytes) and type
+    desc_str[0] = (uint16_t)((TUSB_DESC_STRING << 8) | (2 * len + 2));
+
+    return desc_str;
+}
@@ -207,6 +207,13 @@ int XmodemReceive(StoreChunkType storeChunk, void *ctx, int destsz, int crc, int
     }
     reject:
     flushinput();
+    if (crc == 2) {
+      /* no retransmission in streaming mode */
+      _outbyte(CAN);
+      _outbyte(CAN);
+      _outbyte(CAN);
+      return -3;
+    }
     _outbyte(NAK);
   }
 }
@@ -35,7 +35,7 @@
  * Config Section
  **********************************************************************************************************************/
 /* Define this if you have your own CCITT-CRC-16 implementation */
-/* #define HAVE_CRC16 */
+#define HAVE_CRC16
 
 /* Define this if you want XMODEM-1K support, it will increase stack usage by 896 bytes */
 #define XMODEM_1K
@@ -47,6 +47,10 @@
 int _inbyte(unsigned short t);
 void _outbyte(int c);
 
+#ifdef HAVE_CRC16
+unsigned short crc16_ccitt(const unsigned char *buffer, int length);
+#endif
+
 /***********************************************************************************************************************
  * Function prototype for storing the received chunks
  **********************************************************************************************************************/
@@ -84,6 +88,11 @@ int XmodemReceive(
  **********************************************************************************************************************/
 #define XmodemReceiveCrc(storeChunk, ctx, destsz) XmodemReceive(storeChunk, ctx, destsz, 1, 0)
 
+/***********************************************************************************************************************
+ * Function shortcut - XMODEM-G Receive (CRC-16, no ACK for each block)
+ **********************************************************************************************************************/
+#define XmodemReceiveG(storeChunk, ctx, destsz) XmodemReceive(storeChunk, ctx, destsz, 2, 0)
+
 /***********************************************************************************************************************
  * Function prototype for fetching the data chunks
  **********************************************************************************************************************/
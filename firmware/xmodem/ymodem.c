@@ -28,6 +28,8 @@
  **********************************************************************************************************************/
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "ymodem.h"
 
 /***********************************************************************************************************************
@@ -82,3 +84,41 @@ int YmodemTransmit(char *fileName, FetchChunkType fetchChunk, void *ctx, int siz
 
   return res;
 }
+
+/***********************************************************************************************************************
+ * YMODEM Receive (Single file)
+ **********************************************************************************************************************/
+int YmodemReceive(StoreChunkType storeChunk, void *ctx, int destsz, int crc)
+{
+  char header[128];
+  int res, tmp, size;
+
+  /* Receive YMODEM header: file name, NUL, file size */
+  memset(header, 0, sizeof(header));
+  tmp = XmodemReceive(NULL, header, sizeof(header), crc, 1);
+  if (tmp < 0) {
+    return tmp;
+  }
+  if (header[0] == '\0') {
+    return 0; /* no file */
+  }
+  header[sizeof(header) - 1] = '\0';
+  size = atoi(&header[strlen(header) + 1]);
+  if ((size > 0) && (size < destsz)) {
+    destsz = size;
+  }
+
+  /* Receive Data */
+  res = XmodemReceive(storeChunk, ctx, destsz, crc, 0);
+  if (res < 0) {
+    return res;
+  }
+
+  /* Receive End Block */
+  tmp = XmodemReceive(NULL, header, sizeof(header), crc, 1);
+  if (tmp < 0) {
+    return tmp;
+  }
+
+  return res;
+}
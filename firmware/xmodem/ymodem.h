@@ -45,4 +45,18 @@ int YmodemTransmit(
   /* Number of bytes to send */
   int size);
 
+/***********************************************************************************************************************
+ * YMODEM Receive (Single file)
+ **********************************************************************************************************************/
+int YmodemReceive(
+  /* Function pointer for storing the received chunks or NULL*/
+  StoreChunkType storeChunk,
+  /* If storeChunk is NULL, pointer to the buffer to store the received data, else function context pointer to pass to
+     storeChunk() */
+  void *ctx,
+  /* Number of bytes to receive at most */
+  int destsz,
+  /* Checksum mode to request: 1 - CRC16, 2 - YMODEM-G (CRC16 and no ACK) */
+  int crc);
+
 #endif // YMODEM_H_
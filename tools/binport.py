@@ -0,0 +1,212 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hirokuni Yano
+#
+# Released under the MIT license.
+# see https://opensource.org/licenses/MIT
+#
+# Client of the binary protocol on the second CDC interface of RP27C512
+# (binport). The console on the first interface stays usable meanwhile.
+#
+#   binport.py -p /dev/ttyACM1 info
+#   binport.py -p /dev/ttyACM1 write rom.bin [--addr 0] [--target ram]
+#   binport.py -p /dev/ttyACM1 read dump.bin [--addr 0] [--len 10000]
+#   binport.py -p /dev/ttyACM1 fill 0 10000 ff
+#   binport.py -p /dev/ttyACM1 sum [0 10000]
+#   binport.py -p /dev/ttyACM1 load 0 | save 0
+#   binport.py -p /dev/ttyACM1 cap [--rom rom.bin]   # stop with Ctrl-C
+#
+# Addresses, lengths and values are hexadecimal like the console commands.
+# Target rom is the image being served (after swap: the swapped in slot),
+# ram is the other slot.
+# Without hardware, binport_sim.py provides a simulated device on a pty.
+#
+import argparse
+import struct
+import sys
+import time
+import zlib
+
+import capdecode
+
+MAGIC = 0x5042
+HEADER = struct.Struct("<HBBIII")
+
+CMD_INFO = 0x01
+CMD_READ = 0x02
+CMD_WRITE = 0x03
+CMD_FILL = 0x04
+CMD_SUM = 0x05
+CMD_LOAD = 0x06
+CMD_SAVE = 0x07
+CMD_CAP_START = 0x08
+CMD_CAP_STOP = 0x09
+
+STATUS = ["ok", "bad command", "bad range", "bad argument", "not available", "failed"]
+TARGETS = {"rom": 0, "ram": 1}
+MODES = ["emulator", "snoop", "clone", "sram"]
+
+
+class BinPortError(Exception):
+    pass
+
+
+class BinPort:
+    def __init__(self, port, timeout=5.0):
+        if isinstance(port, str):
+            import serial
+            port = serial.Serial(port, timeout=timeout)
+            port.reset_input_buffer()
+        self.port = port
+        self.pending = bytearray()
+
+    def close(self):
+        self.port.close()
+
+    def _read(self, size):
+        data = bytearray()
+        if self.pending:
+            data += self.pending[:size]
+            del self.pending[:size]
+        while len(data) < size:
+            chunk = self.port.read(size - len(data))
+            if not chunk:
+                raise BinPortError("timeout")
+            data += chunk
+        return bytes(data)
+
+    def _request(self, cmd, target=0, addr=0, length=0, arg=0, data=b""):
+        self.port.write(HEADER.pack(MAGIC, cmd, target, addr, length, arg) + data)
+        return self._response(cmd)
+
+    def _response(self, cmd):
+        while True:
+            head = self._read(2)
+            if struct.unpack("<H", head)[0] != MAGIC:
+                # resync on the next byte
+                self.pending[:0] = head[1:]
+                continue
+            magic, rcmd, status, value, length, extra = HEADER.unpack(head + self._read(HEADER.size - 2))
+            if rcmd != cmd:
+                raise BinPortError("unexpected response %02x to %02x" % (rcmd, cmd))
+            if status != 0:
+                raise BinPortError(STATUS[status] if status < len(STATUS) else "status %d" % status)
+            return value, length, extra
+
+    def info(self):
+        mode, length, words = self._request(CMD_INFO)
+        return self._read(length).decode(), mode, words
+
+    def read(self, addr, length, target="rom"):
+        _, length, _ = self._request(CMD_READ, TARGETS[target], addr, length)
+        return self._read(length)
+
+    def write(self, addr, data, target="rom"):
+        self._request(CMD_WRITE, TARGETS[target], addr, len(data), data=bytes(data))
+
+    def fill(self, addr, length, value, target="rom"):
+        self._request(CMD_FILL, TARGETS[target], addr, length, value)
+
+    def sum(self, addr, length, target="rom"):
+        # CRC-32 (IEEE 802.3) and byte sum, same as the sum command
+        crc32, _, total = self._request(CMD_SUM, TARGETS[target], addr, length)
+        return crc32, total
+
+    def load(self, bank, target="rom"):
+        self._request(CMD_LOAD, TARGETS[target], arg=bank)
+
+    def save(self, bank):
+        self._request(CMD_SAVE, TARGETS["rom"], arg=bank)
+
+    def capture(self, decoder, stop=lambda: False):
+        # feeds capbin frames to decoder until stop() or KeyboardInterrupt
+        self._request(CMD_CAP_START)
+        decoder.feed(self.pending)
+        self.pending.clear()
+        try:
+            while not decoder.done and not stop():
+                decoder.feed(self.port.read(4096))
+        except KeyboardInterrupt:
+            pass
+        self.port.write(HEADER.pack(MAGIC, CMD_CAP_STOP, 0, 0, 0, 0))
+        while not decoder.done:
+            data = self.port.read(4096)
+            if not data:
+                raise BinPortError("timeout")
+            decoder.feed(data)
+        # the response follows the end frame
+        self.pending = decoder.buf
+        self._response(CMD_CAP_STOP)
+
+
+def hexint(s):
+    return int(s, 16)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="RP27C512 binary protocol client")
+    parser.add_argument("-p", "--port", required=True, help="serial port of the binport interface")
+    parser.add_argument("-t", "--target", choices=TARGETS.keys(), default="rom", help="image (default: rom)")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("info")
+    p = sub.add_parser("read")
+    p.add_argument("file")
+    p.add_argument("--addr", type=hexint, default=0)
+    p.add_argument("--len", type=hexint, default=0x10000)
+    p = sub.add_parser("write")
+    p.add_argument("file")
+    p.add_argument("--addr", type=hexint, default=0)
+    p = sub.add_parser("fill")
+    p.add_argument("start", type=hexint)
+    p.add_argument("len", type=hexint)
+    p.add_argument("value", type=hexint)
+    p = sub.add_parser("sum")
+    p.add_argument("start", type=hexint, nargs="?", default=0)
+    p.add_argument("len", type=hexint, nargs="?", default=0x10000)
+    p = sub.add_parser("load")
+    p.add_argument("bank", type=int)
+    p = sub.add_parser("save")
+    p.add_argument("bank", type=int)
+    p = sub.add_parser("cap")
+    p.add_argument("--rom", help="ROM image for reads of run records")
+    args = parser.parse_args()
+
+    dev = BinPort(args.port)
+    start = time.monotonic()
+    if args.cmd == "info":
+        magic, mode, words = dev.info()
+        print("%s, mode %s, %d words/record" % (magic, MODES[mode] if mode < len(MODES) else mode, words))
+    elif args.cmd == "read":
+        data = dev.read(args.addr, args.len, args.target)
+        open(args.file, "wb").write(data)
+        print("%d bytes in %.1f ms" % (len(data), (time.monotonic() - start) * 1000))
+    elif args.cmd == "write":
+        data = open(args.file, "rb").read()
+        dev.write(args.addr, data, args.target)
+        elapsed = time.monotonic() - start
+        crc32, _ = dev.sum(args.addr, len(data), args.target)
+        print("%d bytes in %.1f ms, %s" % (len(data), elapsed * 1000,
+                                           "verified" if crc32 == zlib.crc32(data) else "VERIFY ERROR"))
+    elif args.cmd == "fill":
+        dev.fill(args.start, args.len, args.value, args.target)
+    elif args.cmd == "sum":
+        crc32, total = dev.sum(args.start, args.len, args.target)
+        print(" crc32 : %08x" % crc32)
+        print(" sum8  : %02x" % (total & 0xff))
+        print(" sum16 : %04x" % (total & 0xffff))
+    elif args.cmd == "load":
+        dev.load(args.bank, args.target)
+    elif args.cmd == "save":
+        dev.save(args.bank)
+    elif args.cmd == "cap":
+        rom = open(args.rom, "rb").read() if args.rom else None
+        dev.capture(capdecode.Decoder(sys.stdout, rom))
+    dev.close()
+
+
+if __name__ == "__main__":
+    try:
+        main()
+    except BinPortError as e:
+        sys.stderr.write("error: %s\n" % e)
+        sys.exit(1)
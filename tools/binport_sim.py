@@ -0,0 +1,205 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hirokuni Yano
+#
+# Released under the MIT license.
+# see https://opensource.org/licenses/MIT
+#
+# Simulated RP27C512 binport device on a pseudo terminal (Linux), to run
+# binport.py without hardware.
+#
+#   binport_sim.py              # prints the pty path, use it with binport.py -p
+#   binport_sim.py --selftest   # runs the client against the simulator
+#
+import argparse
+import os
+import select
+import struct
+import sys
+import threading
+import tty
+import zlib
+
+import binport
+import capdecode
+
+MAGIC_STR = b"RP27C512 VER1.10"
+
+
+class Device:
+    def __init__(self, fd):
+        self.fd = fd
+        self.mem = [bytearray(0x10000), bytearray(0x10000)]
+        self.banks = [bytearray(0x10000) for _ in range(4)]
+        self.buf = bytearray()
+        self.cap = False
+        self.seq = 0
+
+    def recv(self, size):
+        while len(self.buf) < size:
+            self.cap_frame()
+            if select.select([self.fd], [], [], 0.001 if self.cap else None)[0]:
+                self.buf += os.read(self.fd, 65536)
+        data = bytes(self.buf[:size])
+        del self.buf[:size]
+        return data
+
+    def send(self, data):
+        os.write(self.fd, data)
+
+    def respond(self, cmd, status=0, value=0, length=0, extra=0):
+        self.send(binport.HEADER.pack(binport.MAGIC, cmd, status, value, length, extra))
+
+    def frame(self, flags, payload):
+        words = [capdecode.MAGIC | (flags << 16) | (len(payload) << 24), self.seq, 0] + payload
+        words.append(sum(words) & 0xffffffff)
+        self.send(struct.pack("<%dI" % len(words), *words))
+
+    def cap_frame(self):
+        if not self.cap:
+            return
+        # sequential reads from 0000
+        payload = [(2 << 28) | (((self.seq + i) & 0xffff) | (self.mem[0][(self.seq + i) & 0xffff] << 16))
+                   for i in range(capdecode.MAX_WORDS)]
+        self.frame(0, payload)
+        self.seq += len(payload)
+
+    def serve(self):
+        while True:
+            if self.recv(2) != struct.pack("<H", binport.MAGIC):
+                continue
+            _, cmd, target, addr, length, arg = binport.HEADER.unpack(struct.pack("<H", binport.MAGIC) +
+                                                                     self.recv(binport.HEADER.size - 2))
+            mem = self.mem[target] if target < 2 else None
+            if cmd == binport.CMD_INFO:
+                self.respond(cmd, 0, 0, len(MAGIC_STR), 1)
+                self.send(MAGIC_STR)
+            elif cmd == binport.CMD_CAP_START:
+                self.respond(cmd, 0, 1)
+                self.frame(capdecode.FLAG_START, [125000000, 1])
+                self.cap = True
+            elif cmd == binport.CMD_CAP_STOP:
+                if self.cap:
+                    self.cap = False
+                    self.frame(capdecode.FLAG_END, [])
+                self.respond(cmd)
+            elif mem is None or addr >= 0x10000 or length > 0x10000 - addr:
+                if cmd == binport.CMD_WRITE:
+                    # the whole payload is discarded
+                    self.recv(length)
+                self.respond(cmd, 3 if mem is None else 2)
+            elif cmd == binport.CMD_READ:
+                self.respond(cmd, 0, 0, length)
+                self.send(bytes(mem[addr:addr + length]))
+            elif cmd == binport.CMD_WRITE:
+                mem[addr:addr + length] = self.recv(length)
+                self.respond(cmd)
+            elif cmd == binport.CMD_FILL:
+                mem[addr:addr + length] = bytes([arg & 0xff]) * length
+                self.respond(cmd)
+            elif cmd == binport.CMD_SUM:
+                data = bytes(mem[addr:addr + length])
+                self.respond(cmd, 0, zlib.crc32(data), 0, sum(data))
+            elif cmd == binport.CMD_LOAD and arg < 4:
+                mem[:] = self.banks[arg]
+                self.respond(cmd)
+            elif cmd == binport.CMD_SAVE and arg < 4 and target == 0:
+                self.banks[arg][:] = mem
+                self.respond(cmd)
+            elif cmd in (binport.CMD_LOAD, binport.CMD_SAVE):
+                self.respond(cmd, 3)
+            else:
+                self.respond(cmd, 1)
+
+
+class PtyPort:
+    # the subset of serial.Serial used by binport.BinPort
+    def __init__(self, path, timeout):
+        self.fd = os.open(path, os.O_RDWR | os.O_NOCTTY)
+        tty.setraw(self.fd)
+        self.timeout = timeout
+
+    def read(self, size):
+        if not select.select([self.fd], [], [], self.timeout)[0]:
+            return b""
+        return os.read(self.fd, size)
+
+    def write(self, data):
+        while data:
+            data = data[os.write(self.fd, data):]
+
+    def close(self):
+        os.close(self.fd)
+
+
+class Collector(capdecode.Decoder):
+    def __init__(self):
+        super().__init__(None)
+        self.records = []
+
+    def note(self, text):
+        pass
+
+    def record(self, rw, addr, data, ctrl, ns):
+        self.records.append((rw, addr, data))
+
+
+def check(name, ok):
+    print("%-24s %s" % (name, "ok" if ok else "FAILED"))
+    return ok
+
+
+def selftest(path):
+    dev = binport.BinPort(PtyPort(path, 5.0))
+    image = bytes((i * 7 + (i >> 8)) & 0xff for i in range(0x10000))
+    ok = True
+
+    magic, _, _ = dev.info()
+    ok &= check("info", magic == MAGIC_STR.decode())
+    dev.write(0, image)
+    ok &= check("write/read", dev.read(0, 0x10000) == image)
+    ok &= check("sum", dev.sum(0, 0x10000) == (zlib.crc32(image), sum(image)))
+    dev.fill(0x100, 0x10, 0xff)
+    ok &= check("fill", dev.read(0xf8, 0x20) == image[0xf8:0x100] + b"\xff" * 0x10 + image[0x110:0x118])
+    dev.write(0x10, b"\x55" * 4, "ram")
+    ok &= check("ram", dev.read(0x10, 4, "ram") == b"\x55" * 4)
+    dev.save(1)
+    dev.fill(0, 0x10000, 0)
+    dev.load(1)
+    ok &= check("save/load", dev.read(0x100, 0x10) == b"\xff" * 0x10)
+    try:
+        dev.write(0xfff0, b"\0" * 0x20)
+        ok &= check("range error", False)
+    except binport.BinPortError:
+        ok &= check("range error", dev.read(0, 4) == image[:4])
+
+    # capture stream: a few frames of sequential reads
+    col = Collector()
+    dev.capture(col, lambda: len(col.records) >= capdecode.MAX_WORDS * 4)
+    ok &= check("capture", all(r == (2, i & 0xffff, (0xff if 0x100 <= i < 0x110 else image[i]))
+                               for i, r in enumerate(col.records)) and col.bad == 0)
+    dev.close()
+    return ok
+
+
+def main():
+    parser = argparse.ArgumentParser(description="simulated RP27C512 binport device")
+    parser.add_argument("--selftest", action="store_true", help="run binport.py against the simulator")
+    args = parser.parse_args()
+
+    master, slave = os.openpty()
+    tty.setraw(master)
+    tty.setraw(slave)
+    path = os.ttyname(slave)
+    thread = threading.Thread(target=Device(master).serve, daemon=True)
+    thread.start()
+
+    if args.selftest:
+        sys.exit(0 if selftest(path) else 1)
+    print(path)
+    sys.stdout.flush()
+    thread.join()
+
+
+if __name__ == "__main__":
+    main()
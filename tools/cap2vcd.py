@@ -0,0 +1,150 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hirokuni Yano
+#
+# Released under the MIT license.
+# see https://opensource.org/licenses/MIT
+#
+# Convert the binary capture stream of RP27C512 (capbin command) into
+# Value Change Dump for PulseView (sigrok) or GTKWave.
+#
+#   cap2vcd.py -p /dev/ttyACM0 -r raw.bin -o trace.vcd   # stop with Ctrl-C
+#   cap2vcd.py raw.bin -o trace.vcd
+#
+# Each access is drawn as a /OE (read) or /WR (write) low pulse with
+# A0-A15, D0-D7, EXT0-EXT2 and /CE valid. With timestamps (capmode ts) the
+# pulses are placed at the captured time, otherwise every --period ns.
+#
+import argparse
+import sys
+
+import capdecode
+
+
+class VcdWriter(capdecode.Decoder):
+    def __init__(self, out, rom, period, pulse, vectors):
+        super().__init__(out, rom)
+        self.period = period
+        self.pulse = pulse
+        self.vectors = vectors
+        self.pending = []
+        self.time = None
+        self.release = None
+        self.value = {}
+        self.ident = {}
+        self.header()
+
+    def header(self):
+        signals = []
+        if self.vectors:
+            signals += [("A", 16), ("D", 8), ("EXT", 3)]
+        else:
+            signals += [("A%d" % i, 1) for i in range(16)]
+            signals += [("D%d" % i, 1) for i in range(8)]
+            signals += [("EXT%d" % i, 1) for i in range(3)]
+        signals += [("nCE", 1), ("nOE", 1), ("nWR", 1)]
+
+        self.out.write("$comment RP27C512 capture $end\n")
+        self.out.write("$timescale 1ns $end\n")
+        self.out.write("$scope module rp27c512 $end\n")
+        for n, (name, width) in enumerate(signals):
+            # identifiers are printable characters from '!'
+            self.ident[name] = chr(ord("!") + n)
+            self.out.write("$var wire %d %s %s $end\n" % (width, self.ident[name], name))
+        self.out.write("$upscope $end\n")
+        self.out.write("$enddefinitions $end\n")
+
+    def change(self, name, value, width=1):
+        if self.value.get(name) == value:
+            return
+        self.value[name] = value
+        if width == 1:
+            self.out.write("%s%s\n" % (value, self.ident[name]))
+        else:
+            self.out.write("b%s %s\n" % (value, self.ident[name]))
+
+    def bus(self, name, value, width):
+        if value is None:
+            bits = "x" * width
+        else:
+            bits = format(value, "0%db" % width)
+        if self.vectors:
+            self.change(name, bits, width)
+        else:
+            for i in range(width):
+                self.change("%s%d" % (name, i), bits[width - 1 - i])
+
+    def at(self, time):
+        if self.time is None or time > self.time:
+            self.out.write("#%d\n" % time)
+            self.time = time
+
+    def strobe_off(self, limit=None):
+        if self.release is None:
+            return
+        time = self.release if limit is None else min(self.release, limit)
+        self.at(time)
+        self.change("nOE", "1")
+        self.change("nWR", "1")
+        self.release = None
+
+    def emit(self, time, rw, addr, data, ctrl):
+        if self.time is not None and time < self.time + 2:
+            # room for the release of the previous pulse
+            time = self.time + 2
+        self.strobe_off(time - 1)
+        self.at(time)
+        self.bus("A", addr, 16)
+        self.bus("D", data, 8)
+        self.bus("EXT", ctrl & 7, 3)
+        self.change("nCE", "1" if ctrl & 8 else "0")
+        self.change("nOE", "0" if rw == 2 else "1")
+        self.change("nWR", "0" if rw == 1 else "1")
+        self.release = time + self.pulse
+
+    def place(self, ns):
+        # reads folded into a run have no timestamp: spread them evenly
+        start = self.time if self.time is not None else ns
+        n = len(self.pending)
+        for k, rec in enumerate(self.pending):
+            if ns is None:
+                time = (self.time if self.time is not None else 0) + self.period
+            else:
+                time = start + (ns - start) * (k + 1) // n
+            self.emit(time, *rec)
+        self.pending = []
+
+    def note(self, text):
+        self.out.write("$comment %s $end\n" % text)
+
+    def record(self, rw, addr, data, ctrl, ns):
+        self.pending.append((rw, addr, data, ctrl))
+        if ns is not None:
+            self.place(ns)
+        elif not self.has_ts:
+            self.place(None)
+
+    def close(self):
+        if self.pending:
+            self.place(None)
+        self.strobe_off()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="convert RP27C512 binary capture stream to VCD")
+    capdecode.add_arguments(parser)
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    parser.add_argument("--period", type=int, default=250, help="access period without timestamp (ns)")
+    parser.add_argument("--pulse", type=int, default=100, help="/OE, /WR pulse width (ns)")
+    parser.add_argument("--vectors", action="store_true", help="A, D, EXT as vectors (GTKWave)")
+    args = parser.parse_args()
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    vcd = VcdWriter(out, capdecode.load_rom(args), args.period, args.pulse, args.vectors)
+    capdecode.decode(vcd, args)
+    vcd.close()
+    out.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,214 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Hirokuni Yano
+#
+# Released under the MIT license.
+# see https://opensource.org/licenses/MIT
+#
+# Decoder for the binary capture stream of RP27C512 (capbin command).
+#
+#   capdecode.py -p /dev/ttyACM0 [-r raw.bin]   # start capbin, stop with Ctrl-C
+#   capdecode.py raw.bin                        # decode a recorded stream
+#
+# Run records (capmode rle: start address, number of reads) are expanded into
+# sequential reads. The data of those reads is taken from the ROM image given
+# by --rom ("--" without it).
+#
+# Output is the same format as the cap command:
+#   R:addr:data[:ns]
+#
+import argparse
+import struct
+import sys
+
+MAGIC = 0x4252
+FLAG_TS = 0x01
+FLAG_START = 0x40
+FLAG_END = 0x80
+HEADER_SIZE = 12
+RUN = 0x40000000
+RUN_LEN = 0x00ff0000
+RUN_LEN_SHIFT = 16
+LOST = 0x80000000
+LOST_STALL = 0x00010000
+LOST_COUNT = 0xffff
+MAX_WORDS = 60
+
+RW = "-WRX"
+
+
+class Decoder:
+    def __init__(self, out, rom=None):
+        self.out = out
+        self.rom = rom
+        self.has_ts = False
+        self.buf = bytearray()
+        self.ts_ps = 0
+        self.ts_last = None
+        self.ts_elapsed = 0
+        self.seq = None
+        self.lost = 0
+        self.bad = 0
+        self.done = False
+
+    def feed(self, data):
+        self.buf += data
+        while not self.done:
+            pos = self.buf.find(b"RB")
+            if pos < 0:
+                del self.buf[:max(0, len(self.buf) - 1)]
+                return
+            del self.buf[:pos]
+            if len(self.buf) < 4:
+                return
+            words = self.buf[3]
+            if words > MAX_WORDS or self.buf[2] & ~(FLAG_TS | FLAG_START | FLAG_END):
+                self.bad += 1
+                del self.buf[:2]
+                continue
+            size = HEADER_SIZE + words * 4 + 4
+            if len(self.buf) < size:
+                return
+            frame = struct.unpack_from("<%dI" % (3 + words + 1), self.buf)
+            if sum(frame[:-1]) & 0xffffffff != frame[-1]:
+                # not a frame: skip the magic and resync
+                self.bad += 1
+                del self.buf[:2]
+                continue
+            del self.buf[:size]
+            self.frame(frame)
+
+    def flush(self):
+        # end of the stream: drop an incomplete frame and resync on the rest
+        while len(self.buf) >= 2 and not self.done:
+            del self.buf[:2]
+            self.feed(b"")
+
+    def note(self, text):
+        self.out.write("# %s\n" % text)
+
+    def record(self, rw, addr, data, ctrl, ns):
+        # data: None if unknown, ns: None without timestamp
+        self.out.write("%c:%04x:%s%s\n" % (RW[rw], addr, "--" if data is None else "%02x" % data,
+                                           "" if ns is None else ":%d" % ns))
+
+    def run(self, start, length, ctrl, ns):
+        for i in range(length):
+            addr = (start + i) & 0xffff
+            data = self.rom[addr] if self.rom and addr < len(self.rom) else None
+            self.record(2, addr, data, ctrl, ns if i == length - 1 else None)
+
+    def frame(self, frame):
+        flags = (frame[0] >> 16) & 0xff
+        seq = frame[1]
+        lost = frame[2]
+        payload = frame[3:-1]
+
+        if flags & FLAG_START:
+            clk, cycles = payload[0], payload[1]
+            self.ts_ps = cycles * 1000000000000 // clk
+            self.ts_last = None
+            self.ts_elapsed = 0
+            self.seq = seq
+            self.lost = 0
+            return
+        words = 2 if flags & FLAG_TS else 1
+        self.has_ts = words > 1
+        if lost != self.lost:
+            self.note("lost %d" % (lost - self.lost))
+        if self.seq is not None and seq - self.seq != lost - self.lost:
+            # frames dropped on the host side (bad frames)
+            self.note("gap %d (seq %d)" % (seq - self.seq - (lost - self.lost), seq))
+        self.lost = lost
+        self.seq = seq + len(payload) // words
+        for i in range(0, len(payload) - words + 1, words):
+            cap = payload[i]
+            ns = None
+            if words > 1:
+                # timestamp counts down and wraps at 32 bits: accumulate the
+                # steps so the time keeps increasing over long captures
+                if self.ts_last is not None:
+                    self.ts_elapsed += (self.ts_last - payload[i + 1]) & 0xffffffff
+                self.ts_last = payload[i + 1]
+                ns = self.ts_elapsed * self.ts_ps // 1000
+            if cap & LOST:
+                # events lost before the capture buffer (dma ring, pio stall)
+                if cap & LOST_STALL:
+                    self.note("lost ? (pio stall, seq %d)" % (seq + i // words))
+                if cap & LOST_COUNT:
+                    self.note("lost %d (dma ring, seq %d)" % (cap & LOST_COUNT, seq + i // words))
+                continue
+            ctrl = (cap >> 24) & 0xf
+            if cap & RUN:
+                self.run(cap & 0xffff, (cap & RUN_LEN) >> RUN_LEN_SHIFT, ctrl, ns)
+                continue
+            rw = (cap >> 28) & 3
+            self.record(rw, cap & 0xffff, (cap >> 16) & 0xff, ctrl, ns)
+        if flags & FLAG_END:
+            self.done = True
+
+
+def add_arguments(parser):
+    parser.add_argument("input", nargs="?", help="recorded stream (default: stdin)")
+    parser.add_argument("-p", "--port", help="serial port of RP27C512")
+    parser.add_argument("-r", "--raw", help="save raw stream to file")
+    parser.add_argument("--rom", help="ROM image for reads of run records")
+
+
+def load_rom(args):
+    return open(args.rom, "rb").read() if args.rom else None
+
+
+def decode(dec, args):
+    raw = open(args.raw, "wb") if args.raw else None
+
+    if args.port:
+        import serial
+        port = serial.Serial(args.port, timeout=0.1)
+        port.reset_input_buffer()
+        port.write(b"capbin\r")
+        try:
+            while not dec.done:
+                data = port.read(4096)
+                if raw:
+                    raw.write(data)
+                dec.feed(data)
+        except KeyboardInterrupt:
+            # any key stops streaming, then wait for the end frame
+            port.write(b" ")
+            while not dec.done:
+                data = port.read(4096)
+                if not data:
+                    break
+                if raw:
+                    raw.write(data)
+                dec.feed(data)
+        port.close()
+    else:
+        src = open(args.input, "rb") if args.input else sys.stdin.buffer
+        while not dec.done:
+            data = src.read(65536)
+            if not data:
+                break
+            dec.feed(data)
+    dec.flush()
+
+    if dec.bad:
+        sys.stderr.write("%d bad frames\n" % dec.bad)
+    if raw:
+        raw.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="decode RP27C512 binary capture stream")
+    add_arguments(parser)
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    out = open(args.output, "w") if args.output else sys.stdout
+    decode(Decoder(out, load_rom(args)), args)
+    out.flush()
+
+
+if __name__ == "__main__":
+    main()